@@ -0,0 +1,408 @@
+/*
+  bucket_skiplist.h - a Skiplist with one node per distinct key, which keeps the values of the key in a bucket.
+
+  A Skiplist creates a node with a full tower for every duplicate of a key, and links it at every level.
+  Here a key has a single node, and its values are packed in a growable block of the node's bucket,
+  so a duplicate takes about sizeof(ValueType) and adding one to a known key is O(1).
+  A removed value leaves a free slot, which is pushed to a stack and reused by the next value of the key,
+  so the (node, slot) handle of a value stays valid until the value is deleted.
+  The node is removed with the last value of its key.
+*/
+#ifndef _BUCKET_SKIPLIST_H_
+#define _BUCKET_SKIPLIST_H_
+
+#include <new>
+#include <utility>
+#include <vector>
+#include <stdlib.h>
+#include "skiplist.h"
+
+/*
+ * The values of a key, in slots of a block that doubles when it's full
+ */
+template <class ValueType>
+class SkiplistBucket{
+    private:
+		ValueType* _values;					//the block, slots from 0 to _size-1 have been used
+		std::vector<bool> _used;			//whether each slot holds a value
+		std::vector<int> _freeSlots;		//stack of the slots whose values are removed
+		int _size;							//how many slots have been used
+		int _capacity;						//how many slots the block has
+		int _count;							//how many values
+
+		//move the values to a block twice as large, the slots don't change, and add a value after them.
+		//The new value is constructed first, as it may refer to a value in the old block
+		template <class Value>
+		bool _grow(Value&& value){
+			int capacity = _capacity ? _capacity*2 : 1;
+			ValueType* values = (ValueType*)malloc(sizeof(ValueType)*capacity);
+
+			if(NULL == values){
+				return false;
+			}
+
+			try{
+				_used.resize(capacity, false);
+				new (&values[_size]) ValueType(std::forward<Value>(value));
+			}catch(...){
+				free(values);
+				throw;
+			}
+
+			for(int i = 0; i < _size; i++){
+				if(_used[i]){
+					new (&values[i]) ValueType(std::move(_values[i]));
+					_values[i].~ValueType();
+				}
+			}
+			free(_values);
+
+			_values = values;
+			_capacity = capacity;
+
+			return true;
+		}
+
+		//not copyable, the values are owned by one bucket
+		SkiplistBucket(const SkiplistBucket&);
+		SkiplistBucket& operator=(const SkiplistBucket&);
+
+    public:
+		SkiplistBucket(): _values(NULL), _size(0), _capacity(0), _count(0){}
+
+		~SkiplistBucket(){
+			for(int i = 0; i < _size; i++){
+				if(_used[i]){
+					_values[i].~ValueType();
+				}
+			}
+			free(_values);
+		}
+
+		/*
+		 * Add a value to a free slot, or after the used slots
+		 *
+		 * @return
+		 * 		the slot, -1 if the block can't grow
+		 */
+		template <class Value>
+		int add(Value&& value){
+			int slot;
+
+			if(!_freeSlots.empty()){
+				slot = _freeSlots.back();
+				new (&_values[slot]) ValueType(std::forward<Value>(value));
+				_freeSlots.pop_back();
+			}else{
+				if(_size < _capacity){
+					new (&_values[_size]) ValueType(std::forward<Value>(value));
+				}else if(!_grow(std::forward<Value>(value))){
+					return -1;
+				}
+				slot = _size;
+				_size++;
+			}
+
+			_used[slot] = true;
+			_count++;
+
+			return slot;
+		}
+
+		/*
+		 * Remove the value of a slot, and push the slot to the free slots
+		 *
+		 * @return
+		 * 		return true if success, false if the slot doesn't hold a value
+		 */
+		bool remove(int slot){
+			if(slot < 0 || slot >= _size || !_used[slot]){
+				return false;
+			}
+
+			_values[slot].~ValueType();
+			_used[slot] = false;
+			_freeSlots.push_back(slot);
+			_count--;
+
+			return true;
+		}
+
+		//the value of a slot, NULL if the slot doesn't hold a value
+		ValueType* at(int slot){
+			return (slot >= 0 && slot < _size && _used[slot]) ? &_values[slot] : NULL;
+		}
+
+		//call visit with each slot that holds a value and the value, in the order of the slots
+		template <class Visitor>
+		void forEach(Visitor&& visit){
+			for(int i = 0; i < _size; i++){
+				if(_used[i]){
+					visit(i, _values[i]);
+				}
+			}
+		}
+
+		int getCount() const{
+			return _count;
+		}
+};
+
+//Handle of a value in a BucketSkiplist
+template <class KeyType, class ValueType>
+struct bucket_skiplist_handle_t{
+	struct skiplist_node_t<KeyType, SkiplistBucket<ValueType> >* node;		//the node of the key, NULL if not inserted
+	int slot;																//the slot of the value in the bucket of the node
+};
+
+//Class for bucket Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType>, class Allocator = SkiplistSlabAllocator>
+class BucketSkiplist{
+    public:
+		typedef Skiplist<KeyType, SkiplistBucket<ValueType>, Compare, Allocator> list_t;
+		typedef struct skiplist_node_t<KeyType, SkiplistBucket<ValueType> > node_t;
+		typedef struct bucket_skiplist_handle_t<KeyType, ValueType> handle_t;
+
+    private:
+		list_t _list;
+		int _count;			//how many values
+
+		template <class Key, class Value>
+		bool _insert(Key&& key, Value&& value, handle_t* handle);
+		template <class Value>
+		bool _append(node_t* node, Value&& value, handle_t* handle);
+
+		//not copyable
+		BucketSkiplist(const BucketSkiplist&);
+		BucketSkiplist& operator=(const BucketSkiplist&);
+
+    public:
+		BucketSkiplist(int maxLevel = DEFAULT_MAX_LEVEL, const Compare& comp = Compare());
+		bool insert(const KeyType& key, const ValueType& value, handle_t* handle);
+		bool insert(KeyType&& key, ValueType&& value, handle_t* handle);
+		bool append(node_t* node, const ValueType& value, handle_t* handle);
+		bool append(node_t* node, ValueType&& value, handle_t* handle);
+		bool del(handle_t* handle);
+		ValueType* get(const handle_t& handle);
+		node_t* search(const KeyType& key);
+		template <class Visitor>
+		int search(const KeyType& key1, const KeyType& key2, Visitor visit);
+		int getKeysNum();
+		int getValuesNum();
+};
+
+/*
+ * Constructor
+ *
+ * @param maxLevel
+ * 		initial max level of the skiplist
+ * @param comp
+ * 		key compare functor
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline BucketSkiplist<KeyType, ValueType, Compare, Allocator>::BucketSkiplist(int maxLevel, const Compare& comp): _list(maxLevel, comp), _count(0){
+}
+
+/*
+ * Add a value to the bucket of a key, the node of the key is inserted if the key is new.
+ * It's O(log(n)) to find the key, see append for O(1) with a known node
+ *
+ * @param key
+ * 		the key
+ * @param value
+ * 		the value
+ * @param handle
+ * 		the handle of the value, which is passed to del and get, served as an output
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::insert(const KeyType& key, const ValueType& value, handle_t* handle){
+	return _insert(key, value, handle);
+}
+
+/*
+ * Add a value to the bucket of a key by moving the key and the value, see insert above
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::insert(KeyType&& key, ValueType&& value, handle_t* handle){
+	return _insert(std::move(key), std::move(value), handle);
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Key, class Value>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::_insert(Key&& key, Value&& value, handle_t* handle){
+	node_t* node = search(key);
+
+	if(NULL == node){
+		//the bucket is constructed empty in the node
+		if(!_list.emplace(&node, std::forward<Key>(key))){
+			handle->node = NULL;
+			return false;
+		}
+
+		if(!_append(node, std::forward<Value>(value), handle)){
+			_list.del(&node);
+			return false;
+		}
+		return true;
+	}
+
+	return _append(node, std::forward<Value>(value), handle);
+}
+
+/*
+ * Add a value to the bucket of a node in O(1), without searching
+ *
+ * @param node
+ * 		the node of the key, from search or the handle of another value of the key
+ * @param value
+ * 		the value
+ * @param handle
+ * 		the handle of the value, served as an output
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::append(node_t* node, const ValueType& value, handle_t* handle){
+	return _append(node, value, handle);
+}
+
+/*
+ * Add a value to the bucket of a node by moving the value, see append above
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::append(node_t* node, ValueType&& value, handle_t* handle){
+	return _append(node, std::move(value), handle);
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Value>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::_append(node_t* node, Value&& value, handle_t* handle){
+	int slot;
+
+	if(NULL == node){
+		std::cout<<"This node is not inserted"<<std::endl;
+		handle->node = NULL;
+		return false;
+	}
+
+	slot = node->value.add(std::forward<Value>(value));
+	if(slot < 0){
+		std::cout<<"create value block fail when append value"<<std::endl;
+		handle->node = NULL;
+		return false;
+	}
+
+	handle->node = node;
+	handle->slot = slot;
+	_count++;
+
+	return true;
+}
+
+/*
+ * Delete a value, its slot is reused by the next value of the key.
+ * The node of the key is removed with its last value
+ *
+ * @param handle
+ * 		the handle of the value, its node is set to NULL
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool BucketSkiplist<KeyType, ValueType, Compare, Allocator>::del(handle_t* handle){
+	if(NULL == handle->node || !handle->node->value.remove(handle->slot)){
+		std::cout<<"This value is not inserted"<<std::endl;
+		return false;
+	}
+
+	if(0 == handle->node->value.getCount()){
+		_list.del(&handle->node);
+	}
+	handle->node = NULL;
+	_count--;
+
+	return true;
+}
+
+/*
+ * Get the value of a handle
+ *
+ * @return
+ * 		the value, NULL if the handle doesn't hold a value
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline ValueType* BucketSkiplist<KeyType, ValueType, Compare, Allocator>::get(const handle_t& handle){
+	return handle.node ? handle.node->value.at(handle.slot) : NULL;
+}
+
+/*
+ * Search for the node of a key, whose bucket holds the values of the key
+ *
+ * @param key
+ * 		a given key
+ *
+ * @return
+ * 		the node, NULL if the key doesn't exist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline typename BucketSkiplist<KeyType, ValueType, Compare, Allocator>::node_t* BucketSkiplist<KeyType, ValueType, Compare, Allocator>::search(const KeyType& key){
+	node_t *start, *end;
+
+	return _list.search(key, &start, &end) ? start : NULL;
+}
+
+/*
+ * Visit the values of the keys within a given range (key1 <= key2), in the order of the keys
+ * and then the slots of each key
+ *
+ * @param key1
+ * 		the lower bound, included
+ * @param key2
+ * 		the upper bound, included
+ * @param visit
+ * 		called with the key, the handle and the value, it can't insert or delete values
+ *
+ * @return
+ * 		how many values are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline int BucketSkiplist<KeyType, ValueType, Compare, Allocator>::search(const KeyType& key1, const KeyType& key2, Visitor visit){
+	node_t *start, *end, *node;
+	int count = 0;
+
+	if(_list.search(key1, key2, &start, &end)){
+		list_each_sl_node(start, end, node){
+			node->value.forEach([&](int slot, ValueType& value){
+				handle_t handle = {node, slot};
+				visit(node->key, handle, value);
+				count++;
+			});
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Get the number of distinct keys, i.e. nodes
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int BucketSkiplist<KeyType, ValueType, Compare, Allocator>::getKeysNum(){
+	return _list.getNodesNum();
+}
+
+/*
+ * Get the number of values of all keys
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int BucketSkiplist<KeyType, ValueType, Compare, Allocator>::getValuesNum(){
+	return _count;
+}
+
+#endif
@@ -0,0 +1,538 @@
+/*
+  concurrent_skiplist.h - a lock-free Skiplist.
+
+  insert, del and search can be called from multiple threads without locks.
+  Nodes are linked by CAS on the next pointers, a node is deleted by marking
+  its next pointers first (the lowest bit), then it is unlinked by whichever
+  thread runs into it (Harris/Fraser). Removed nodes are released through
+  the epochs in skiplist_epoch.h.
+*/
+#ifndef _CONCURRENT_SKIPLIST_H_
+#define _CONCURRENT_SKIPLIST_H_
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+
+template<class KeyType, class ValueType>
+struct concurrent_skiplist_node_t{
+    KeyType key;						//the key of this node
+    ValueType value;					//the value of this node
+	int level;							//how many levels this node has, from 1 to _maxLevel
+	std::atomic<bool> fullyLinked;		//whether the node is linked at all its levels
+	std::atomic<uintptr_t> next[];		//pointers to the next nodes at each level,
+										//the lowest bit is set when the node is deleted
+};
+
+/*
+ * Loop through the nodes from start to end returned by ConcurrentSkiplist::search.
+ * Nodes deleted in the meantime are skipped, and the loop stops at the end
+ * or at the first node with a different key, even if the end is deleted.
+ * The caller has to hold a SkiplistEpochGuard from the search until the end of the loop.
+ */
+#define list_each_csl_node(list,start,end,node) \
+	for(node = start; node != NULL;				\
+		node = (node == end) ? NULL : (list).nextInRun(node))
+
+//Class for lock-free Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType> >
+class ConcurrentSkiplist{
+    private:
+		std::atomic<int> _curr_level;		//how many levels are in use, from 0 to _maxLevel
+		int _maxLevel;						//larger than 1
+		std::atomic<int> _count;			//how many nodes in this Skiplist
+		struct concurrent_skiplist_node_t<KeyType,ValueType>* _sudoHead;
+		Compare _comp;						//key compare functor
+
+		static struct concurrent_skiplist_node_t<KeyType,ValueType>* _ptr(uintptr_t link){
+			return (struct concurrent_skiplist_node_t<KeyType,ValueType>*)(link & ~(uintptr_t)1);
+		}
+
+		static bool _isMarked(uintptr_t link){
+			return link & 1;
+		}
+
+		void _init(int maxLevel);
+		struct concurrent_skiplist_node_t<KeyType,ValueType>* _createNode(const KeyType& key, const ValueType& value, int level);
+		static void _freeNode(void* node);
+		int _randomLevel();
+		struct concurrent_skiplist_node_t<KeyType,ValueType>* _last(const KeyType& key);
+		bool _find(const KeyType& key, struct concurrent_skiplist_node_t<KeyType,ValueType>* target, struct concurrent_skiplist_node_t<KeyType,ValueType>** prevNodes, struct concurrent_skiplist_node_t<KeyType,ValueType>** nextNodes);
+
+		//not copyable
+		ConcurrentSkiplist(const ConcurrentSkiplist&);
+		ConcurrentSkiplist& operator=(const ConcurrentSkiplist&);
+
+    public:
+		ConcurrentSkiplist();
+		ConcurrentSkiplist(int maxLevel,const Compare& comp = Compare());
+		~ConcurrentSkiplist();
+		bool insert(const KeyType& key, const ValueType& value, struct concurrent_skiplist_node_t<KeyType,ValueType>** node);
+		bool del(struct concurrent_skiplist_node_t<KeyType,ValueType>** node);
+		bool search(const KeyType& key, struct concurrent_skiplist_node_t<KeyType,ValueType>** start, struct concurrent_skiplist_node_t<KeyType,ValueType>** end);
+		struct concurrent_skiplist_node_t<KeyType,ValueType>* nextInRun(struct concurrent_skiplist_node_t<KeyType,ValueType>* node);
+		int getCurrentLevel();
+		int getNodesNum();
+};
+
+/*
+ * Default constructor, the max level is set to DEFAULT_MAX_LEVEL
+ */
+template <class KeyType, class ValueType, class Compare>
+inline ConcurrentSkiplist<KeyType, ValueType, Compare>::ConcurrentSkiplist(){
+	_init(DEFAULT_MAX_LEVEL);
+}
+
+/*
+ * Constructor which requires to specify the max level and optionally the key compare functor
+ *
+ * @param maxLevel
+ * 		user specified max level
+ * @param comp
+ * 		user defined key compare functor, has to follow the return rule of the default key compare function
+ */
+template <class KeyType, class ValueType, class Compare>
+inline ConcurrentSkiplist<KeyType, ValueType, Compare>::ConcurrentSkiplist(int maxLevel,const Compare& comp): _comp(comp){
+	_init(maxLevel);
+}
+
+/*
+ * Initialise an empty skiplist, shared by the constructors
+ *
+ * @param maxLevel
+ * 		the max level
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void ConcurrentSkiplist<KeyType, ValueType, Compare>::_init(int maxLevel){
+	_curr_level.store(0);
+	_count.store(0);
+	_maxLevel = maxLevel;
+
+	_sudoHead = (struct concurrent_skiplist_node_t<KeyType,ValueType>*)malloc(sizeof(struct concurrent_skiplist_node_t<KeyType,ValueType>) + _maxLevel*sizeof(std::atomic<uintptr_t>));
+
+	if(NULL == _sudoHead){
+		std::cout<<"create concurrent_skiplist_node_t fail when creating skiplist"<<std::endl;
+		return;
+	}
+
+	_sudoHead->level = _maxLevel;
+	for(int i=0;i<_maxLevel;i++){
+		new (&_sudoHead->next[i]) std::atomic<uintptr_t>(0);
+	}
+}
+
+/*
+ * Default destructor
+ * No other thread may access the skiplist any more, the remaining nodes are released
+ */
+template <class KeyType, class ValueType, class Compare>
+inline ConcurrentSkiplist<KeyType, ValueType, Compare>::~ConcurrentSkiplist(){
+	struct concurrent_skiplist_node_t<KeyType,ValueType> *node, *next;
+
+	if(NULL == _sudoHead){
+		return;
+	}
+
+	//marked nodes that are still linked haven't been retired yet by their deleting thread,
+	//which can't happen as no thread is accessing the skiplist
+	for(node = _ptr(_sudoHead->next[0].load()); node != NULL; node = next){
+		next = _ptr(node->next[0].load());
+		_freeNode(node);
+	}
+
+	free(_sudoHead);
+}
+
+/*
+ * Create a node with specified key, value and levels
+ *
+ * @return
+ * 		return the created node if success.
+ */
+template <class KeyType, class ValueType, class Compare>
+inline struct concurrent_skiplist_node_t<KeyType,ValueType>* ConcurrentSkiplist<KeyType, ValueType, Compare>::_createNode(const KeyType& key, const ValueType& value, int level){
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* node = (struct concurrent_skiplist_node_t<KeyType,ValueType>*)malloc(sizeof(struct concurrent_skiplist_node_t<KeyType,ValueType>) + level*sizeof(std::atomic<uintptr_t>));
+
+	if(NULL == node){
+		std::cout<<"create concurrent_skiplist_node_t fail when create node"<<std::endl;
+		return NULL;
+	}
+
+	new (&node->key) KeyType(key);
+	new (&node->value) ValueType(value);
+	node->level = level;
+	new (&node->fullyLinked) std::atomic<bool>(false);
+	for(int i=0;i<level;i++){
+		new (&node->next[i]) std::atomic<uintptr_t>(0);
+	}
+
+	return node;
+}
+
+/*
+ * Release a node, it's the deleter of the retired nodes
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void ConcurrentSkiplist<KeyType, ValueType, Compare>::_freeNode(void* ptr){
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* node = (struct concurrent_skiplist_node_t<KeyType,ValueType>*)ptr;
+
+	node->key.~KeyType();
+	node->value.~ValueType();
+	free(node);
+}
+
+/*
+ * Compute the level for a node, with the same probability as Skiplist.
+ * Every thread has its own random number generator.
+ *
+ * @return
+ * 		the level, from 0 to _maxLevel-1
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int ConcurrentSkiplist<KeyType, ValueType, Compare>::_randomLevel(){
+	static thread_local SkiplistRandom s_rand;
+
+	int level = __builtin_ctzll(s_rand.next() | (1ULL << 63)) / SKIPLIST_LEVEL_SHIFT;
+
+	if(level >= _maxLevel)
+		level = _maxLevel-1;
+
+	return level;
+}
+
+/*
+ * Search for the prev nodes and the next nodes of a key at each level, marked nodes on the way are unlinked.
+ *
+ * @param key
+ * 		the key to search for
+ * @param target
+ * 		if it's NULL, nextNodes are the first nodes with a key equal or larger than the given key,
+ * 		otherwise nextNodes are the target node if it's linked at that level, and the target is unlinked if it's marked
+ * @param prevNodes
+ * 		the prev nodes at each level, served as an output
+ * @param nextNodes
+ * 		the next nodes at each level, served as an output
+ *
+ * @return
+ * 		return true if the node at level 0 is the target, or has the given key if the target is NULL
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool ConcurrentSkiplist<KeyType, ValueType, Compare>::_find(const KeyType& key, struct concurrent_skiplist_node_t<KeyType,ValueType>* target, struct concurrent_skiplist_node_t<KeyType,ValueType>** prevNodes, struct concurrent_skiplist_node_t<KeyType,ValueType>** nextNodes){
+	struct concurrent_skiplist_node_t<KeyType,ValueType> *cursor, *prev, *existNode;
+	uintptr_t next;
+
+retry:
+	cursor = _sudoHead;
+	for(int i = _curr_level.load()-1; i >= 0; i--){
+		prev = cursor;
+		existNode = _ptr(prev->next[i].load());
+
+		while(existNode){
+			next = existNode->next[i].load();
+
+			//existNode is deleted, unlink it
+			if(_isMarked(next)){
+				uintptr_t expected = (uintptr_t)existNode;
+				if(!prev->next[i].compare_exchange_strong(expected, next & ~(uintptr_t)1)){
+					goto retry;
+				}
+				existNode = _ptr(next);
+				continue;
+			}
+
+			int comp = _comp(existNode->key, key);
+			if(comp < 0){
+				//only nodes with a smaller key are used to go down,
+				//as nodes with the same key can be in different orders at different levels
+				cursor = prev = existNode;
+			}else if(comp == 0 && target != NULL && existNode != target){
+				prev = existNode;
+			}else{
+				break;
+			}
+			existNode = _ptr(next);
+		}
+
+		prevNodes[i] = prev;
+		nextNodes[i] = existNode;
+	}
+
+	if(NULL == nextNodes[0]){
+		return false;
+	}
+
+	return (target != NULL) ? (nextNodes[0] == target) : (_comp(nextNodes[0]->key, key) == 0);
+}
+
+/*
+ * Insert a node into the skiplist
+ * A node with an existing key is inserted before the nodes with the same key
+ *
+ * @param key
+ * 		the key of the node
+ * @param value
+ * 		the value of the node
+ * @param node
+ * 		the address of a pointer points to the node that will be allocated memory in this function,
+ * 		has to be NULL when calling this function
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool ConcurrentSkiplist<KeyType, ValueType, Compare>::insert(const KeyType& key, const ValueType& value, struct concurrent_skiplist_node_t<KeyType,ValueType>** node){
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* prevNodes[_maxLevel];
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* nextNodes[_maxLevel];
+
+	if(*node != NULL){
+		std::cout<<"This node is already inserted"<<std::endl;
+		return false;
+	}
+
+	int level = _randomLevel();
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* newNode = _createNode(key, value, level+1);
+
+	if(NULL == newNode){
+		std::cout<<"create node fail in insert"<<std::endl;
+		return false;
+	}
+
+	//raise the current level first, so the searches go through all levels of the new node
+	int currLevel = _curr_level.load();
+	while(currLevel < level+1 && !_curr_level.compare_exchange_weak(currLevel, level+1));
+
+	SkiplistEpochGuard guard;
+
+	//the node is in the skiplist once it's linked at level 0
+	while(true){
+		_find(key, NULL, prevNodes, nextNodes);
+
+		for(int i = 0; i <= level; i++){
+			newNode->next[i].store((uintptr_t)nextNodes[i], std::memory_order_relaxed);
+		}
+
+		uintptr_t expected = (uintptr_t)nextNodes[0];
+		if(prevNodes[0]->next[0].compare_exchange_strong(expected, (uintptr_t)newNode)){
+			break;
+		}
+	}
+
+	//link the upper levels
+	for(int i = 1; i <= level; i++){
+		while(true){
+			uintptr_t expected = (uintptr_t)nextNodes[i];
+			if(prevNodes[i]->next[i].compare_exchange_strong(expected, (uintptr_t)newNode)){
+				break;
+			}
+
+			//the prev node changed, search again and point to the new next node
+			_find(key, NULL, prevNodes, nextNodes);
+
+			uintptr_t next = newNode->next[i].load();
+			if(_isMarked(next) || !newNode->next[i].compare_exchange_strong(next, (uintptr_t)nextNodes[i])){
+				//the node is being deleted, stop linking
+				break;
+			}
+		}
+	}
+
+	newNode->fullyLinked.store(true, std::memory_order_release);
+	_count++;
+	*node = newNode;
+
+	return true;
+}
+
+/*
+ * Remove a given node from the list
+ *
+ * @param node
+ * 		an address of a pointer points to the node that needs to be removed
+ *
+ * @return
+ * 		return true if success, false if the node is removed by another thread
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool ConcurrentSkiplist<KeyType, ValueType, Compare>::del(struct concurrent_skiplist_node_t<KeyType,ValueType>** node){
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* prevNodes[_maxLevel];
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* nextNodes[_maxLevel];
+
+	if(NULL == *node){
+		std::cout<<"This node is not inserted"<<std::endl;
+		return false;
+	}
+
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* target = *node;
+
+	//a node found by search may still be linking its upper levels
+	while(!target->fullyLinked.load(std::memory_order_acquire)){
+		std::this_thread::yield();
+	}
+
+	SkiplistEpochGuard guard;
+
+	//mark the upper levels from the top level
+	for(int i = target->level-1; i >= 1; i--){
+		uintptr_t next = target->next[i].load();
+		while(!_isMarked(next) && !target->next[i].compare_exchange_weak(next, next | 1));
+	}
+
+	//the thread that marks level 0 owns the deletion
+	uintptr_t next = target->next[0].load();
+	while(true){
+		if(_isMarked(next)){
+			return false;
+		}
+		if(target->next[0].compare_exchange_weak(next, next | 1)){
+			break;
+		}
+	}
+
+	//unlink the node at all levels
+	_find(target->key, target, prevNodes, nextNodes);
+
+	_count--;
+	SkiplistEpoch::retire(target, _freeNode);
+	*node = NULL;
+
+	return true;
+}
+
+/*
+ * Search for nodes with a given key, without locks or writes
+ * The caller has to hold a SkiplistEpochGuard while the output nodes are used,
+ * and loop through them by list_each_csl_node
+ *
+ * @param key
+ * 		a given key
+ * @param start
+ * 		An address of a pointer points to the first node with the given key, served as an output
+ * @param end
+ * 		An address of a pointer points to the last node with the given key, served as an output
+ *
+ * @return
+ * 		if nodes with the given key exist, return true and the *start and *end are not NULL,
+ * 		otherwise return false, and the *start == *end == NULL
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool ConcurrentSkiplist<KeyType, ValueType, Compare>::search(const KeyType& key, struct concurrent_skiplist_node_t<KeyType,ValueType>** start, struct concurrent_skiplist_node_t<KeyType,ValueType>** end){
+	struct concurrent_skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead, *node;
+	uintptr_t next;
+
+	*start = *end = NULL;
+
+	SkiplistEpochGuard guard;
+
+	for(int i = _curr_level.load(std::memory_order_acquire)-1; i >= 0; i--){
+		existNode = _ptr(cursor->next[i].load(std::memory_order_acquire));
+
+		while(existNode){
+			next = existNode->next[i].load(std::memory_order_acquire);
+
+			//skip deleted nodes
+			if(!_isMarked(next)){
+				if(_comp(existNode->key, key) >= 0){
+					break;
+				}
+				cursor = existNode;
+			}
+			existNode = _ptr(next);
+		}
+	}
+
+	if(NULL == existNode || _comp(existNode->key, key) != 0){
+		return false;
+	}
+
+	*start = *end = existNode;
+
+	//the end is found by a second descent, so a long run of duplicates isn't walked
+	node = _last(key);
+	if(node && _comp(node->key, key) == 0){
+		*end = node;
+	}
+
+	return true;
+}
+
+/*
+ * Find the last node with a key equal or smaller than a given key, without locks or writes.
+ * The descent moves over the nodes with the same key at every level, a node with the same key is never
+ * after the last one at level 0, so the nodes with the key being in different orders at different levels doesn't matter.
+ * The nodes of a run get random levels like the others, so it's O(log(n)) however long the run is.
+ * The caller has to hold a SkiplistEpochGuard
+ *
+ * @param key
+ * 		a given key
+ *
+ * @return
+ * 		the node, NULL if all keys are larger
+ */
+template <class KeyType, class ValueType, class Compare>
+inline struct concurrent_skiplist_node_t<KeyType,ValueType>* ConcurrentSkiplist<KeyType, ValueType, Compare>::_last(const KeyType& key){
+	struct concurrent_skiplist_node_t<KeyType,ValueType> *existNode, *cursor=_sudoHead;
+	uintptr_t next;
+
+	for(int i = _curr_level.load(std::memory_order_acquire)-1; i >= 0; i--){
+		existNode = _ptr(cursor->next[i].load(std::memory_order_acquire));
+
+		while(existNode){
+			next = existNode->next[i].load(std::memory_order_acquire);
+
+			//skip deleted nodes
+			if(!_isMarked(next)){
+				if(_comp(existNode->key, key) > 0){
+					break;
+				}
+				cursor = existNode;
+			}
+			existNode = _ptr(next);
+		}
+	}
+
+	return (cursor == _sudoHead) ? NULL : cursor;
+}
+
+/*
+ * Get the next node that is not deleted at level 0 if it has the same key as the given node
+ *
+ * @param node
+ * 		a given node
+ *
+ * @return
+ * 		the next node with the same key, NULL if there isn't one
+ */
+template <class KeyType, class ValueType, class Compare>
+inline struct concurrent_skiplist_node_t<KeyType,ValueType>* ConcurrentSkiplist<KeyType, ValueType, Compare>::nextInRun(struct concurrent_skiplist_node_t<KeyType,ValueType>* node){
+	struct concurrent_skiplist_node_t<KeyType,ValueType>* next = _ptr(node->next[0].load(std::memory_order_acquire));
+
+	while(next && _isMarked(next->next[0].load(std::memory_order_acquire))){
+		next = _ptr(next->next[0].load(std::memory_order_acquire));
+	}
+
+	if(next && _comp(next->key, node->key) == 0){
+		return next;
+	}
+
+	return NULL;
+}
+
+/*
+ * Get the current number of levels
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int ConcurrentSkiplist<KeyType, ValueType, Compare>::getCurrentLevel(){
+	return _curr_level.load();
+}
+
+/*
+ * Get the number of nodes
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int ConcurrentSkiplist<KeyType, ValueType, Compare>::getNodesNum(){
+	return _count.load();
+}
+
+#endif
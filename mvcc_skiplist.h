@@ -0,0 +1,318 @@
+/*
+  mvcc_skiplist.h - a Skiplist with versioned nodes, so readers can scan a consistent snapshot while the writer goes on.
+
+  Every write gets the next version. A node keeps the version that inserted it and the version that deleted it,
+  and del only marks the node as deleted. A snapshot is the version of the last write when it's taken,
+  a reader at a snapshot sees the nodes inserted at or before it and not deleted at or before it.
+  gc removes the deleted nodes no registered snapshot can see any more.
+
+  The nodes are kept in a Skiplist with the SkiplistSwmrSync policy, so one thread writes (insert, del, gc)
+  and any thread reads (snapshot, release, search, forEach) without blocking the writer.
+*/
+#ifndef _MVCC_SKIPLIST_H_
+#define _MVCC_SKIPLIST_H_
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+
+#define MVCC_SKIPLIST_LIVE UINT64_MAX		//the deleted version of a node that is not deleted
+#define MVCC_SKIPLIST_GC_THRESHOLD 1024		//how many nodes del marks as deleted before it calls gc
+
+//The value of a node with the versions that inserted and deleted it
+template <class ValueType>
+struct mvcc_value_t{
+	ValueType value;
+	uint64_t created;		//the version that inserted the node
+	uint64_t deleted;		//the version that deleted the node, MVCC_SKIPLIST_LIVE if it's not deleted
+
+	template <class Value>
+	mvcc_value_t(Value&& value, uint64_t created): value(std::forward<Value>(value)), created(created), deleted(MVCC_SKIPLIST_LIVE){}
+};
+
+//Class for MVCC Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType>, class Allocator = SkiplistSlabAllocator>
+class MvccSkiplist{
+    public:
+		typedef Skiplist<KeyType, mvcc_value_t<ValueType>, Compare, Allocator, SkiplistSwmrSync> list_t;
+		typedef struct skiplist_node_t<KeyType, mvcc_value_t<ValueType> > node_t;
+
+    private:
+		list_t _list;
+		Compare _comp;
+		std::atomic<uint64_t> _version;			//the version of the last write
+		std::vector<node_t*> _deleted;			//nodes marked as deleted in the order of their versions, only used by the writer
+		std::mutex _snapshotsLock;
+		std::multiset<uint64_t> _snapshots;		//the registered snapshots
+
+		static bool _visible(const node_t* node, uint64_t snapshot){
+			return node->value.created <= snapshot && __atomic_load_n(&node->value.deleted, __ATOMIC_ACQUIRE) > snapshot;
+		}
+
+		//not copyable
+		MvccSkiplist(const MvccSkiplist&);
+		MvccSkiplist& operator=(const MvccSkiplist&);
+
+    public:
+		MvccSkiplist(int maxLevel = DEFAULT_MAX_LEVEL, const Compare& comp = Compare());
+		bool insert(const KeyType& key, const ValueType& value, node_t** node);
+		bool insert(KeyType&& key, ValueType&& value, node_t** node);
+		bool del(node_t** node);
+		int gc();
+		uint64_t snapshot();
+		void release(uint64_t snapshot);
+		template <class Visitor>
+		bool search(uint64_t snapshot, const KeyType& key, Visitor visit);
+		template <class Visitor>
+		int search(uint64_t snapshot, const KeyType& key1, const KeyType& key2, Visitor visit);
+		template <class Visitor>
+		int forEach(uint64_t snapshot, Visitor visit);
+		uint64_t getVersion();
+		int getNodesNum();
+};
+
+/*
+ * Constructor
+ *
+ * @param maxLevel
+ * 		initial max level of the skiplist
+ * @param comp
+ * 		key compare functor
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline MvccSkiplist<KeyType, ValueType, Compare, Allocator>::MvccSkiplist(int maxLevel, const Compare& comp): _list(maxLevel, comp), _comp(comp), _version(0){
+}
+
+/*
+ * Insert a node at the next version, called by the writer.
+ * The node is linked before the version is published, so a snapshot that sees the version sees the node
+ *
+ * @param key
+ * 		the key
+ * @param value
+ * 		the value
+ * @param node
+ * 		an address of a pointer to the node, which has to be NULL, served as an output
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool MvccSkiplist<KeyType, ValueType, Compare, Allocator>::insert(const KeyType& key, const ValueType& value, node_t** node){
+	uint64_t version = _version.load(std::memory_order_relaxed) + 1;
+
+	if(!_list.emplace(node, key, value, version)){
+		return false;
+	}
+	_version.store(version, std::memory_order_release);
+
+	return true;
+}
+
+/*
+ * Insert a node at the next version by moving the key and the value into it, see insert above
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool MvccSkiplist<KeyType, ValueType, Compare, Allocator>::insert(KeyType&& key, ValueType&& value, node_t** node){
+	uint64_t version = _version.load(std::memory_order_relaxed) + 1;
+
+	if(!_list.emplace(node, std::move(key), std::move(value), version)){
+		return false;
+	}
+	_version.store(version, std::memory_order_release);
+
+	return true;
+}
+
+/*
+ * Delete a node at the next version, called by the writer.
+ * The node is only marked, the snapshots taken before still see it until they are released,
+ * and gc removes it from the skiplist afterwards
+ *
+ * @param node
+ * 		an address of a pointer to the node, set to NULL
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool MvccSkiplist<KeyType, ValueType, Compare, Allocator>::del(node_t** node){
+	uint64_t version = _version.load(std::memory_order_relaxed) + 1;
+
+	if(NULL == *node || (*node)->value.deleted != MVCC_SKIPLIST_LIVE){
+		std::cout<<"This node is not inserted"<<std::endl;
+		return false;
+	}
+
+	//mark the node before the version is published, so a snapshot that sees the version doesn't see the node
+	__atomic_store_n(&(*node)->value.deleted, version, __ATOMIC_RELEASE);
+	_version.store(version, std::memory_order_release);
+
+	_deleted.push_back(*node);
+	*node = NULL;
+
+	if(_deleted.size() % MVCC_SKIPLIST_GC_THRESHOLD == 0){
+		gc();
+	}
+
+	return true;
+}
+
+/*
+ * Remove the deleted nodes that no registered snapshot can see from the skiplist, called by the writer.
+ * Readers may still be on the removed nodes, the skiplist releases them after the readers have left
+ *
+ * @return
+ * 		how many nodes are removed
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int MvccSkiplist<KeyType, ValueType, Compare, Allocator>::gc(){
+	uint64_t oldest;
+	size_t removed;
+
+	//a snapshot registered later is at this version or after
+	{
+		std::lock_guard<std::mutex> lock(_snapshotsLock);
+		oldest = _snapshots.empty() ? _version.load() : *_snapshots.begin();
+	}
+
+	for(removed = 0; removed < _deleted.size() && _deleted[removed]->value.deleted <= oldest; removed++){
+		_list.del(&_deleted[removed]);
+	}
+	_deleted.erase(_deleted.begin(), _deleted.begin() + removed);
+
+	return (int)removed;
+}
+
+/*
+ * Take and register a snapshot at the version of the last write.
+ * The nodes it sees are kept until it's released
+ *
+ * @return
+ * 		the snapshot
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline uint64_t MvccSkiplist<KeyType, ValueType, Compare, Allocator>::snapshot(){
+	std::lock_guard<std::mutex> lock(_snapshotsLock);
+	uint64_t version = _version.load(std::memory_order_acquire);
+
+	_snapshots.insert(version);
+
+	return version;
+}
+
+/*
+ * Release a snapshot taken by snapshot
+ *
+ * @param snapshot
+ * 		the snapshot, it can't be read at afterwards
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline void MvccSkiplist<KeyType, ValueType, Compare, Allocator>::release(uint64_t snapshot){
+	std::lock_guard<std::mutex> lock(_snapshotsLock);
+	std::multiset<uint64_t>::iterator it = _snapshots.find(snapshot);
+
+	if(it != _snapshots.end()){
+		_snapshots.erase(it);
+	}
+}
+
+/*
+ * Visit the nodes with a given key that a snapshot sees
+ *
+ * @param snapshot
+ * 		a registered snapshot
+ * @param key
+ * 		the key
+ * @param visit
+ * 		called with the key and the value of each node
+ *
+ * @return
+ * 		return true if the key exists at the snapshot
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline bool MvccSkiplist<KeyType, ValueType, Compare, Allocator>::search(uint64_t snapshot, const KeyType& key, Visitor visit){
+	return search(snapshot, key, key, visit) > 0;
+}
+
+/*
+ * Visit the nodes within a given range (key1 <= key2) that a snapshot sees, in the order of the keys
+ *
+ * @param snapshot
+ * 		a registered snapshot
+ * @param key1
+ * 		the lower bound, included
+ * @param key2
+ * 		the upper bound, included
+ * @param visit
+ * 		called with the key and the value of each node
+ *
+ * @return
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline int MvccSkiplist<KeyType, ValueType, Compare, Allocator>::search(uint64_t snapshot, const KeyType& key1, const KeyType& key2, Visitor visit){
+	SkiplistEpochGuard guard;
+	int count = 0;
+
+	//loop by the keys, the node after the range may be removed meanwhile
+	for(typename list_t::iterator it = _list.lower_bound(key1); it != _list.end() && _comp(it->key, key2) <= 0; ++it){
+		if(_visible(&*it, snapshot)){
+			visit(it->key, it->value.value);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Visit all nodes that a snapshot sees, in the order of the keys
+ *
+ * @param snapshot
+ * 		a registered snapshot
+ * @param visit
+ * 		called with the key and the value of each node
+ *
+ * @return
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline int MvccSkiplist<KeyType, ValueType, Compare, Allocator>::forEach(uint64_t snapshot, Visitor visit){
+	SkiplistEpochGuard guard;
+	int count = 0;
+
+	for(typename list_t::iterator it = _list.begin(); it != _list.end(); ++it){
+		if(_visible(&*it, snapshot)){
+			visit(it->key, it->value.value);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Get the version of the last write
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline uint64_t MvccSkiplist<KeyType, ValueType, Compare, Allocator>::getVersion(){
+	return _version.load(std::memory_order_acquire);
+}
+
+/*
+ * Get the number of nodes in the skiplist, including the deleted ones that gc hasn't removed
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int MvccSkiplist<KeyType, ValueType, Compare, Allocator>::getNodesNum(){
+	return _list.getNodesNum();
+}
+
+#endif
@@ -0,0 +1,551 @@
+/*
+  packed_skiplist.h - a Skiplist which packs multiple sorted keys into each node.
+
+  Every node holds up to NodeKeys sorted keys and their values in arrays, like a leaf of a B+ tree,
+  and the towers of the Skiplist only index the first key of each node.
+  A scan reads NodeKeys keys per node instead of chasing one pointer per key,
+  and the levels, tail and prev pointers are paid once per node instead of once per key.
+  Keys and values are moved by memmove, so both have to be trivially copyable.
+*/
+#ifndef _PACKED_SKIPLIST_H_
+#define _PACKED_SKIPLIST_H_
+
+#include <string.h>
+#include <type_traits>
+#include "skiplist.h"
+#include "skiplist_simd.h"
+
+#define SKIPLIST_PACKED_NODE_KEYS 16		//default number of keys in a node
+#define SKIPLIST_CACHE_LINE 64				//nodes start at a cache line
+
+template<class KeyType, class ValueType, int NodeKeys>
+struct packed_skiplist_node_t{
+	KeyType keys[NodeKeys];			//sorted keys, the first count of them are valid
+	ValueType values[NodeKeys];		//the value of each key
+	int count;						//how many keys in this node, from 1 to NodeKeys
+	int level;						//how many levels this node has, from 1 to _maxLevel
+	struct packed_skiplist_node_t<KeyType,ValueType,NodeKeys>* next[];	//an array that holds the pointers to next nodes at each level
+};
+
+//Class for packed Skiplist
+template <class KeyType, class ValueType, int NodeKeys = SKIPLIST_PACKED_NODE_KEYS, class Compare = SkiplistDefaultComp<KeyType> >
+class PackedSkiplist{
+	static_assert(NodeKeys >= 2, "a node has to hold at least 2 keys");
+	static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+		"keys and values of PackedSkiplist have to be trivially copyable");
+
+    public:
+		typedef struct packed_skiplist_node_t<KeyType,ValueType,NodeKeys> node_t;
+
+		/*
+		 * Forward iterator over the keys from the smallest to the largest
+		 */
+		class iterator{
+				friend class PackedSkiplist;
+
+		    private:
+				node_t* _node;		//NULL for the end
+				int _idx;			//index of the key in the node
+
+		    public:
+				iterator(): _node(NULL), _idx(0){}
+				iterator(node_t* node, int idx): _node(node), _idx(idx){}
+
+				const KeyType& key() const{
+					return _node->keys[_idx];
+				}
+
+				ValueType& value() const{
+					return _node->values[_idx];
+				}
+
+				iterator& operator++(){
+					if(++_idx == _node->count){
+						_node = _node->next[0];
+						_idx = 0;
+					}
+					return *this;
+				}
+
+				bool operator==(const iterator& other) const{
+					return _node == other._node && _idx == other._idx;
+				}
+
+				bool operator!=(const iterator& other) const{
+					return !(*this == other);
+				}
+		};
+
+    private:
+		int _curr_level;			//how many levels are in use, from 0 to _maxLevel
+		int _maxLevel;				//larger than 1
+		int _count;					//how many keys in this Skiplist
+		int _nodes;					//how many nodes in this Skiplist
+		node_t* _sudoHead;			//has no keys
+		Compare _comp;				//key compare functor
+		SkiplistRandom _rand;		//random number generator of the levels
+		bool _simd;					//whether the keys in a node are searched by SIMD
+
+		void _init(int maxLevel, uint64_t seed);
+		//whether the keys are compared by operator<, which the SIMD search does
+		static bool _nativeComp(){ return std::is_same<Compare, SkiplistDefaultComp<KeyType> >::value; }
+		node_t* _createNode(int level);
+		int _randomLevel();
+		int _nodeLowerBound(const node_t* node, const KeyType& key) const;
+		int _nodeUpperBound(const node_t* node, const KeyType& key) const;
+		node_t* _findNode(const KeyType& key, node_t** prevNodes) const;
+		void _removeNode(node_t* node, const KeyType& firstKey);
+
+		//not copyable
+		PackedSkiplist(const PackedSkiplist&);
+		PackedSkiplist& operator=(const PackedSkiplist&);
+
+    public:
+		PackedSkiplist();
+		PackedSkiplist(int maxLevel,const Compare& comp = Compare(),uint64_t seed = 0);
+		~PackedSkiplist();
+		bool insert(const KeyType& key, const ValueType& value);
+		bool erase(const KeyType& key);
+		iterator find(const KeyType& key);
+		iterator lower_bound(const KeyType& key);
+		iterator upper_bound(const KeyType& key);
+		iterator begin();
+		iterator end();
+		int getCurrentLevel();
+		int getNodesNum();
+		int getKeysNum();
+		void printList();
+};
+
+/*
+ * Default constructor, the max level is set to DEFAULT_MAX_LEVEL
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::PackedSkiplist(){
+	_init(DEFAULT_MAX_LEVEL, 0);
+}
+
+/*
+ * Constructor which requires to specify the max level, and optionally the key compare functor and the seed
+ *
+ * @param maxLevel
+ * 		user specified max level
+ * @param comp
+ * 		user defined key compare functor, has to follow the return rule of the default key compare function
+ * @param seed
+ * 		seed of the random levels, 0 to seed randomly
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::PackedSkiplist(int maxLevel,const Compare& comp,uint64_t seed): _comp(comp){
+	_init(maxLevel, seed);
+}
+
+/*
+ * Initialise an empty skiplist, shared by the constructors
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline void PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_init(int maxLevel, uint64_t seed){
+	_curr_level = 0;
+	_count = 0;
+	_nodes = 0;
+	_maxLevel = maxLevel;
+	_rand.seed(seed);
+	//SIMD compares by operator<, which only matches the default key compare functor
+	_simd = skiplist_simd_key_t<KeyType>::value && _nativeComp();
+
+	_sudoHead = _createNode(_maxLevel);
+	if(NULL == _sudoHead){
+		std::cout<<"create packed_skiplist_node_t fail when creating skiplist"<<std::endl;
+	}
+}
+
+/*
+ * Default destructor
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::~PackedSkiplist(){
+	node_t *node, *next;
+
+	if(NULL == _sudoHead){
+		return;
+	}
+
+	for(node = _sudoHead->next[0]; node != NULL; node = next){
+		next = node->next[0];
+		free(node);
+	}
+	free(_sudoHead);
+}
+
+/*
+ * Create an empty node at a cache line boundary
+ *
+ * @param level
+ * 		how many levels this node has
+ *
+ * @return
+ * 		return the created node if success.
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::node_t* PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_createNode(int level){
+	void* memory;
+
+	if(posix_memalign(&memory, SKIPLIST_CACHE_LINE, sizeof(node_t) + level*sizeof(node_t*)) != 0){
+		return NULL;
+	}
+
+	node_t* node = (node_t*)memory;
+	node->count = 0;
+	node->level = level;
+	for(int i = 0; i < level; i++){
+		node->next[i] = NULL;
+	}
+
+	return node;
+}
+
+/*
+ * Compute the level for a node, with the same probability as Skiplist
+ *
+ * @return
+ * 		the level
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_randomLevel(){
+	int level = __builtin_ctzll(_rand.next() | (1ULL << 63)) / SKIPLIST_LEVEL_SHIFT;
+	int limit = (_curr_level < _maxLevel-1) ? _curr_level : _maxLevel-1;
+
+	return (level < limit) ? level : limit;
+}
+
+/*
+ * Find the index of the first key in a node that is equal or larger than a given key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_nodeLowerBound(const node_t* node, const KeyType& key) const{
+	int idx = 0;
+
+	if(_simd){
+		return skiplistSimdCount(node->keys, node->count, key, false);
+	}
+
+	while(idx < node->count && _comp(node->keys[idx], key) < 0)
+		idx++;
+
+	return idx;
+}
+
+/*
+ * Find the index of the first key in a node that is larger than a given key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_nodeUpperBound(const node_t* node, const KeyType& key) const{
+	int idx = 0;
+
+	if(_simd){
+		return skiplistSimdCount(node->keys, node->count, key, true);
+	}
+
+	while(idx < node->count && _comp(node->keys[idx], key) <= 0)
+		idx++;
+
+	return idx;
+}
+
+/*
+ * Search for the last node whose first key is smaller than a given key
+ *
+ * @param key
+ * 		a given key
+ * @param prevNodes
+ * 		the last node whose first key is smaller than the given key at each level, served as an output.
+ * 		It can be NULL
+ *
+ * @return
+ * 		the node, or the _sudoHead if the first keys of all nodes are equal or larger than the given key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::node_t* PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_findNode(const KeyType& key, node_t** prevNodes) const{
+	node_t *existNode, *cursor = _sudoHead;
+
+	for(int i = _curr_level-1; i >= 0; i--){
+		while( (existNode = cursor->next[i]) && _comp(existNode->keys[0], key) < 0)
+			cursor = existNode;
+
+		if(prevNodes){
+			prevNodes[i] = cursor;
+		}
+	}
+
+	return cursor;
+}
+
+/*
+ * Insert a key and its value
+ * A key that exists is inserted before the same keys
+ *
+ * @param key
+ * 		the key
+ * @param value
+ * 		the value
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline bool PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::insert(const KeyType& key, const ValueType& value){
+	node_t* prevNodes[_maxLevel];
+	node_t *node, *newNode;
+	int pos;
+
+	for(int i = _curr_level; i < _maxLevel; i++){
+		prevNodes[i] = _sudoHead;
+	}
+
+	node = _findNode(key, prevNodes);
+
+	if(node == _sudoHead){
+		//the key is smaller than all first keys, it goes to the front of the first node
+		node = _sudoHead->next[0];
+		pos = 0;
+	}else{
+		pos = _nodeLowerBound(node, key);
+	}
+
+	//the node is full or there isn't a node, create a new node after it
+	if(NULL == node || node->count == NodeKeys){
+		int level = _randomLevel();
+		if(level == _curr_level){
+			_curr_level++;
+		}
+
+		newNode = _createNode(level+1);
+		if(NULL == newNode){
+			std::cout<<"create node fail in insert"<<std::endl;
+			return false;
+		}
+
+		//link the new node right after the node, at the levels the node doesn't have
+		//the prev nodes of the key are before the node
+		for(int i = newNode->level-1; i >= 0; i--){
+			node_t* prev = (node && node->level > i) ? node : prevNodes[i];
+			newNode->next[i] = prev->next[i];
+			prev->next[i] = newNode;
+		}
+		_nodes++;
+
+		if(NULL == node){
+			node = newNode;
+		}else{
+			//move the upper half of the keys to the new node
+			int half = NodeKeys / 2;
+			newNode->count = NodeKeys - half;
+			node->count = half;
+			memcpy(newNode->keys, node->keys + half, newNode->count*sizeof(KeyType));
+			memcpy(newNode->values, node->values + half, newNode->count*sizeof(ValueType));
+
+			if(pos > half){
+				node = newNode;
+				pos -= half;
+			}
+		}
+	}
+
+	memmove(node->keys + pos + 1, node->keys + pos, (node->count - pos)*sizeof(KeyType));
+	memmove(node->values + pos + 1, node->values + pos, (node->count - pos)*sizeof(ValueType));
+	node->keys[pos] = key;
+	node->values[pos] = value;
+	node->count++;
+	_count++;
+
+	return true;
+}
+
+/*
+ * Unlink and release an empty node
+ *
+ * @param node
+ * 		the node
+ * @param firstKey
+ * 		the first key the node had, which orders the node
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline void PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::_removeNode(node_t* node, const KeyType& firstKey){
+	node_t* prevNodes[_maxLevel];
+	node_t* existNode;
+
+	_findNode(firstKey, prevNodes);
+
+	//nodes before it may start with the same key
+	for(int i = node->level-1; i >= 0; i--){
+		while((existNode = prevNodes[i]->next[i]) != node)
+			prevNodes[i] = existNode;
+
+		prevNodes[i]->next[i] = node->next[i];
+	}
+
+	//lower down the current level if the top levels are empty
+	while(_curr_level > 0 && NULL == _sudoHead->next[_curr_level-1])
+		_curr_level--;
+
+	_nodes--;
+	free(node);
+}
+
+/*
+ * Erase the first key equal to a given key
+ *
+ * @param key
+ * 		the key
+ *
+ * @return
+ * 		return true if success, false if the key doesn't exist
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline bool PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::erase(const KeyType& key){
+	iterator it = lower_bound(key);
+	node_t* node = it._node;
+	int pos = it._idx;
+
+	if(it == end() || _comp(it.key(), key) != 0){
+		return false;
+	}
+
+	if(node->count == 1){
+		_removeNode(node, key);
+	}else{
+		node->count--;
+		memmove(node->keys + pos, node->keys + pos + 1, (node->count - pos)*sizeof(KeyType));
+		memmove(node->values + pos, node->values + pos + 1, (node->count - pos)*sizeof(ValueType));
+	}
+	_count--;
+
+	return true;
+}
+
+/*
+ * Get an iterator to the first key equal to a given key
+ *
+ * @return
+ * 		the iterator, end() if the key doesn't exist
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::iterator PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::find(const KeyType& key){
+	iterator it = lower_bound(key);
+
+	if(it != end() && _comp(it.key(), key) == 0){
+		return it;
+	}
+
+	return end();
+}
+
+/*
+ * Get an iterator to the first key equal or larger than a given key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::iterator PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::lower_bound(const KeyType& key){
+	node_t* node = _findNode(key, NULL);
+	int pos = 0;
+
+	if(node != _sudoHead){
+		pos = _nodeLowerBound(node, key);
+	}
+
+	//all keys of the node are smaller, the next node starts with a key equal or larger than the given key
+	if(node == _sudoHead || pos == node->count){
+		node = node->next[0];
+		pos = 0;
+	}
+
+	return iterator(node, pos);
+}
+
+/*
+ * Get an iterator to the first key larger than a given key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::iterator PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::upper_bound(const KeyType& key){
+	node_t *existNode, *cursor = _sudoHead;
+	int pos = 0;
+
+	//the last node whose first key is equal or smaller than the given key
+	for(int i = _curr_level-1; i >= 0; i--){
+		while( (existNode = cursor->next[i]) && _comp(existNode->keys[0], key) <= 0)
+			cursor = existNode;
+	}
+
+	if(cursor != _sudoHead){
+		pos = _nodeUpperBound(cursor, key);
+	}
+
+	if(cursor == _sudoHead || pos == cursor->count){
+		cursor = cursor->next[0];
+		pos = 0;
+	}
+
+	return iterator(cursor, pos);
+}
+
+/*
+ * Get an iterator to the smallest key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::iterator PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::begin(){
+	return iterator(_sudoHead->next[0], 0);
+}
+
+/*
+ * Get an iterator past the largest key
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline typename PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::iterator PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::end(){
+	return iterator(NULL, 0);
+}
+
+/*
+ * Get the current number of levels
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::getCurrentLevel(){
+	return _curr_level;
+}
+
+/*
+ * Get the number of nodes, each holds up to NodeKeys keys
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::getNodesNum(){
+	return _nodes;
+}
+
+/*
+ * Get the number of keys
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline int PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::getKeysNum(){
+	return _count;
+}
+
+/*
+ * Print the first key and the number of keys of the nodes at each level, start from the current top level to level 0
+ */
+template <class KeyType, class ValueType, int NodeKeys, class Compare>
+inline void PackedSkiplist<KeyType, ValueType, NodeKeys, Compare>::printList(){
+	node_t* node;
+
+	std::cout<<"Skiplist has "<<_count<<" keys in "<<_nodes<<" nodes."<<std::endl;
+	for(int i = _curr_level-1; i >= 0; --i){
+		int count = 0;
+		std::cout<<"level "<<i<<":"<<std::endl;
+		for(node = _sudoHead->next[i]; node != NULL; node = node->next[i]){
+			count++;
+			std::cout<<"("<<node->keys[0]<<", "<<node->count<<")";
+			std::cout<<((NULL == node->next[i]) ? "\n" : "->");
+		}
+		std::cout<<"count: "<<count<<std::endl;
+	}
+	std::cout<<std::endl;
+}
+
+#endif
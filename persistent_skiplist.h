@@ -0,0 +1,800 @@
+/*
+  persistent_skiplist.h - a Skiplist that lives in a memory mapped file.
+
+  The head, the nodes and the shared tail cells are allocated in the file and point to each other
+  by their offsets from the start of the file, so the file can be mapped at any address.
+  Reopening a file is a mmap and a check of its header, the list is not rebuilt.
+
+  Crash consistency, if the process crashes:
+  	- insert fills a node before it's linked, and links it from level 0 up,
+  	  del unlinks a node from the top level down to level 0, and releases it afterwards.
+  	  So level 0 is a complete sorted list after every store, and every upper level is part of it.
+  	  Compiler fences keep the stores in this order, the stores of a crashed process stay in the page cache.
+  	- the header is marked dirty, and synced, before the first change after a checkpoint.
+  	  Opening a dirty file rebuilds the upper levels, the tails and the counters from level 0.
+  	- a file that grew before its new size was stored in the header is opened with the size of the file.
+  A crash of the system only keeps what checkpoint and close synced to the disk. Nothing is synced between
+  the changes, as an msync per insert would cost a write to the disk, so the pages changed after the last
+  checkpoint are written back in any order, and a file changed after its last checkpoint may not be
+  recoverable after a crash of the system.
+  A block that was allocated but not linked when the process crashed is not reused.
+  Keys and values are stored as they are, so both have to be trivially copyable,
+  and the file can only be opened by the same key and value types on the same architecture.
+*/
+#ifndef _PERSISTENT_SKIPLIST_H_
+#define _PERSISTENT_SKIPLIST_H_
+
+#include <atomic>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include "skiplist.h"
+
+#define PERSISTENT_SKIPLIST_MAGIC 0x54534c50494b53ULL	//"SKIPLST"
+#define PERSISTENT_SKIPLIST_VERSION 2				//2: the head has PERSISTENT_SKIPLIST_MAX_LEVEL levels
+#define PERSISTENT_SKIPLIST_MAX_LEVEL 32				//the max level of a persistent skiplist can grow to it
+#define PERSISTENT_SKIPLIST_INITIAL_SIZE (1 << 20)		//size of a new file, it's doubled when full
+#define PERSISTENT_SKIPLIST_ALIGN 16					//blocks in the file are aligned to it
+
+//offset of a block from the start of the file, 0 is NULL as the header is at 0
+typedef uint64_t skiplist_offset_t;
+
+//The header at the start of the file
+struct persistent_skiplist_header_t{
+	uint64_t magic;
+	uint32_t version;
+	uint32_t keySize;					//sizeof the key type
+	uint32_t valueSize;					//sizeof the value type
+	int32_t maxLevel;					//the highest level a new node can have, grows with the number of nodes
+	int32_t currLevel;					//how many levels are in use
+	uint32_t dirty;						//1 if changed after the last checkpoint
+	uint64_t count;						//how many nodes
+	uint64_t fileSize;
+	uint64_t used;						//the blocks end here, the rest of the file is free
+	skiplist_offset_t head;				//the head node, which has PERSISTENT_SKIPLIST_MAX_LEVEL levels
+	skiplist_offset_t freeLists[PERSISTENT_SKIPLIST_MAX_LEVEL+1];	//released blocks of each number of levels, 0 for tail cells
+};
+
+template<class KeyType, class ValueType>
+struct persistent_skiplist_node_t{
+	KeyType key;				//the key of this node
+	ValueType value;			//the value of this node
+	int level;					//how many levels this node has, from 1 to maxLevel
+	skiplist_offset_t tail;		//the cell shared by a list of nodes that have the same key, which holds the last one of them
+	skiplist_offset_t prev;		//the prev node with the same key, 0 if the node is the head of the list or the key is unique
+	skiplist_offset_t next[];	//the next nodes at each level
+};
+
+/*
+ * Loop through the nodes from start to end, both are offsets.
+ * The caller has to ensure the start and end are not 0
+ */
+#define list_each_psl_node(list,start,end,node) \
+	for(node = start, end = (list).getNode(end)->next[0];		\
+		node != end; node = (list).getNode(node)->next[0])
+
+//Class for persistent Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType> >
+class PersistentSkiplist{
+	static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+		"keys and values of PersistentSkiplist have to be trivially copyable");
+
+    public:
+		typedef struct persistent_skiplist_node_t<KeyType,ValueType> node_t;
+
+    private:
+		int _fd;					//the file, -1 if not opened
+		char* _base;				//where the file is mapped
+		Compare _comp;				//key compare functor
+		SkiplistRandom _rand;		//random number generator of the levels
+
+		struct persistent_skiplist_header_t* _header() const{ return (struct persistent_skiplist_header_t*)_base; }
+		node_t* _node(skiplist_offset_t offset) const{ return (node_t*)(_base + offset); }
+		skiplist_offset_t* _cell(skiplist_offset_t offset) const{ return (skiplist_offset_t*)(_base + offset); }
+		static size_t _nodeSize(int level);
+		static size_t _blockSize(int sizeClass);
+		char* _map(size_t size);
+		bool _grow(size_t size);
+		void _growLevel(uint64_t count);
+		skiplist_offset_t _allocate(int sizeClass);
+		void _deallocate(skiplist_offset_t offset, int sizeClass);
+		void _markDirty();
+		void _recover();
+		int _randomLevel();
+
+		//not copyable
+		PersistentSkiplist(const PersistentSkiplist&);
+		PersistentSkiplist& operator=(const PersistentSkiplist&);
+
+    public:
+		PersistentSkiplist(const Compare& comp = Compare(),uint64_t seed = 0);
+		~PersistentSkiplist();
+		bool open(const char* path, int maxLevel = DEFAULT_MAX_LEVEL);
+		bool close();
+		bool checkpoint();
+		bool insert(const KeyType& key, const ValueType& value, skiplist_offset_t* node);
+		bool del(skiplist_offset_t* node);
+		bool search(const KeyType& key, skiplist_offset_t* start, skiplist_offset_t* end);
+		bool search(const KeyType& key1, const KeyType& key2, skiplist_offset_t* start, skiplist_offset_t* end);
+		node_t* getNode(skiplist_offset_t node);
+		skiplist_offset_t first();
+		int getCurrentLevel();
+		int getNodesNum();
+		void printList();
+};
+
+/*
+ * Constructor, the skiplist is usable after open
+ *
+ * @param comp
+ * 		key compare functor, has to be the same every time the file is opened
+ * @param seed
+ * 		seed of the random levels, 0 to seed randomly
+ */
+template <class KeyType, class ValueType, class Compare>
+inline PersistentSkiplist<KeyType, ValueType, Compare>::PersistentSkiplist(const Compare& comp,uint64_t seed): _fd(-1), _base(NULL), _comp(comp){
+	_rand.seed(seed);
+}
+
+/*
+ * Destructor, a checkpoint is taken if the file is opened
+ */
+template <class KeyType, class ValueType, class Compare>
+inline PersistentSkiplist<KeyType, ValueType, Compare>::~PersistentSkiplist(){
+	close();
+}
+
+/*
+ * Compute the memory size of a node
+ */
+template <class KeyType, class ValueType, class Compare>
+inline size_t PersistentSkiplist<KeyType, ValueType, Compare>::_nodeSize(int level){
+	return sizeof(node_t) + level*sizeof(skiplist_offset_t);
+}
+
+/*
+ * Compute the size of a block in the file, sizeClass is the number of levels of a node, 0 for a tail cell
+ */
+template <class KeyType, class ValueType, class Compare>
+inline size_t PersistentSkiplist<KeyType, ValueType, Compare>::_blockSize(int sizeClass){
+	size_t size = (sizeClass == 0) ? sizeof(skiplist_offset_t) : _nodeSize(sizeClass);
+
+	return (size + PERSISTENT_SKIPLIST_ALIGN - 1) & ~(size_t)(PERSISTENT_SKIPLIST_ALIGN - 1);
+}
+
+/*
+ * Map the file
+ *
+ * @param size
+ * 		size of the file
+ *
+ * @return
+ * 		where the file is mapped, NULL if fail
+ */
+template <class KeyType, class ValueType, class Compare>
+inline char* PersistentSkiplist<KeyType, ValueType, Compare>::_map(size_t size){
+	void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+	if(MAP_FAILED == base){
+		std::cout<<"mmap fail"<<std::endl;
+		return NULL;
+	}
+
+	return (char*)base;
+}
+
+/*
+ * Enlarge the file so that a block of a given size fits, and map it again.
+ * Nodes may be moved to another address, but not another offset
+ *
+ * @param size
+ * 		size of the block
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::_grow(size_t size){
+	uint64_t oldSize = _header()->fileSize;
+	uint64_t newSize = oldSize * 2;
+	char* base;
+
+	while(newSize < _header()->used + size){
+		newSize *= 2;
+	}
+
+	if(ftruncate(_fd, newSize) != 0){
+		std::cout<<"ftruncate fail when growing the file"<<std::endl;
+		return false;
+	}
+
+	//the old mapping is kept until the new one works, so the skiplist is still usable if mmap fails.
+	//The file is larger than the header says until the new size is stored, open takes the size of the file
+	base = _map(newSize);
+	if(NULL == base){
+		return false;
+	}
+	munmap(_base, oldSize);
+	_base = base;
+	_header()->fileSize = newSize;
+
+	return true;
+}
+
+/*
+ * Raise the max level for a given number of nodes, as Skiplist does.
+ * The head has all the levels, so only the header changes
+ *
+ * @param count
+ * 		the number of nodes
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void PersistentSkiplist<KeyType, ValueType, Compare>::_growLevel(uint64_t count){
+	struct persistent_skiplist_header_t* header = _header();
+
+	while(header->maxLevel < PERSISTENT_SKIPLIST_MAX_LEVEL && SKIPLIST_LEVEL_SHIFT*header->maxLevel < 64 &&
+	      (count >> (SKIPLIST_LEVEL_SHIFT*header->maxLevel)) != 0){
+		header->maxLevel++;
+	}
+}
+
+/*
+ * Allocate a block, from the released blocks of the same size class or the end of the used blocks
+ *
+ * @param sizeClass
+ * 		the number of levels of a node, 0 for a tail cell
+ *
+ * @return
+ * 		the offset of the block, 0 if fail
+ */
+template <class KeyType, class ValueType, class Compare>
+inline skiplist_offset_t PersistentSkiplist<KeyType, ValueType, Compare>::_allocate(int sizeClass){
+	skiplist_offset_t offset = _header()->freeLists[sizeClass];
+	size_t size = _blockSize(sizeClass);
+
+	//a released block holds the offset of the next released block
+	if(offset){
+		_header()->freeLists[sizeClass] = *_cell(offset);
+		return offset;
+	}
+
+	if(_header()->used + size > _header()->fileSize && !_grow(size)){
+		return 0;
+	}
+
+	offset = _header()->used;
+	_header()->used += size;
+
+	return offset;
+}
+
+/*
+ * Release a block to the released blocks of its size class
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void PersistentSkiplist<KeyType, ValueType, Compare>::_deallocate(skiplist_offset_t offset, int sizeClass){
+	*_cell(offset) = _header()->freeLists[sizeClass];
+	_header()->freeLists[sizeClass] = offset;
+}
+
+/*
+ * Mark the file dirty before the first change after a checkpoint, the mark is synced to the disk
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void PersistentSkiplist<KeyType, ValueType, Compare>::_markDirty(){
+	if(_header()->dirty){
+		return;
+	}
+
+	_header()->dirty = 1;
+	msync(_base, sizeof(struct persistent_skiplist_header_t), MS_SYNC);
+}
+
+/*
+ * Rebuild the upper levels, the tails, the prev pointers and the counters from level 0,
+ * after the process crashed with changes in progress
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void PersistentSkiplist<KeyType, ValueType, Compare>::_recover(){
+	struct persistent_skiplist_header_t* header = _header();
+	skiplist_offset_t last[PERSISTENT_SKIPLIST_MAX_LEVEL];
+	skiplist_offset_t offset, prev = 0;
+	node_t* node;
+
+	header->count = 0;
+	header->currLevel = 0;
+	for(int i = 0; i < header->maxLevel; i++){
+		last[i] = header->head;
+	}
+
+	for(offset = _node(header->head)->next[0]; offset; offset = node->next[0]){
+		node = _node(offset);
+
+		//link the node at each of its levels after the last node at that level
+		for(int i = 1; i < node->level; i++){
+			_node(last[i])->next[i] = offset;
+			last[i] = offset;
+		}
+		last[0] = offset;
+		if(node->level > header->currLevel){
+			header->currLevel = node->level;
+		}
+
+		//nodes with the same key share the tail of the first one
+		if(prev && _comp(_node(prev)->key, node->key) == 0){
+			node->prev = prev;
+			node->tail = _node(prev)->tail;
+		}else{
+			node->prev = 0;
+		}
+		*_cell(node->tail) = offset;
+
+		prev = offset;
+		header->count++;
+	}
+
+	for(int i = 1; i < header->maxLevel; i++){
+		_node(last[i])->next[i] = 0;
+	}
+}
+
+/*
+ * Open a file, or create it if it doesn't exist
+ *
+ * @param path
+ * 		path of the file
+ * @param maxLevel
+ * 		initial max level of a new file, it grows with the number of nodes
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::open(const char* path, int maxLevel){
+	struct persistent_skiplist_header_t* header;
+	struct stat st;
+
+	if(_fd >= 0){
+		std::cout<<"The skiplist is already opened"<<std::endl;
+		return false;
+	}
+
+	_fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if(_fd < 0 || fstat(_fd, &st) != 0){
+		std::cout<<"open "<<path<<" fail"<<std::endl;
+		close();
+		return false;
+	}
+
+	if(0 == st.st_size){
+		//a new file
+		if(maxLevel < 2 || maxLevel > PERSISTENT_SKIPLIST_MAX_LEVEL){
+			std::cout<<"max level has to be from 2 to "<<PERSISTENT_SKIPLIST_MAX_LEVEL<<std::endl;
+			close();
+			return false;
+		}
+
+		if(ftruncate(_fd, PERSISTENT_SKIPLIST_INITIAL_SIZE) != 0 || NULL == (_base = _map(PERSISTENT_SKIPLIST_INITIAL_SIZE))){
+			close();
+			return false;
+		}
+
+		header = _header();
+		memset(header, 0, sizeof(struct persistent_skiplist_header_t));
+		header->version = PERSISTENT_SKIPLIST_VERSION;
+		header->keySize = sizeof(KeyType);
+		header->valueSize = sizeof(ValueType);
+		header->maxLevel = maxLevel;
+		header->fileSize = PERSISTENT_SKIPLIST_INITIAL_SIZE;
+		header->used = (sizeof(struct persistent_skiplist_header_t) + PERSISTENT_SKIPLIST_ALIGN - 1) & ~(size_t)(PERSISTENT_SKIPLIST_ALIGN - 1);
+		header->head = _allocate(PERSISTENT_SKIPLIST_MAX_LEVEL);
+		_node(header->head)->level = PERSISTENT_SKIPLIST_MAX_LEVEL;
+		for(int i = 0; i < PERSISTENT_SKIPLIST_MAX_LEVEL; i++){
+			_node(header->head)->next[i] = 0;
+		}
+
+		//the magic is written last, a file without it is not valid
+		msync(_base, header->used, MS_SYNC);
+		header->magic = PERSISTENT_SKIPLIST_MAGIC;
+		msync(_base, sizeof(struct persistent_skiplist_header_t), MS_SYNC);
+
+		return true;
+	}
+
+	if((size_t)st.st_size < sizeof(struct persistent_skiplist_header_t) || NULL == (_base = _map(st.st_size))){
+		std::cout<<path<<" is not a skiplist file"<<std::endl;
+		close();
+		return false;
+	}
+
+	header = _header();
+	if(header->magic != PERSISTENT_SKIPLIST_MAGIC || header->version != PERSISTENT_SKIPLIST_VERSION ||
+	   header->fileSize > (uint64_t)st.st_size || header->used > header->fileSize ||
+	   header->maxLevel < 1 || header->maxLevel > PERSISTENT_SKIPLIST_MAX_LEVEL){
+		std::cout<<path<<" is not a skiplist file"<<std::endl;
+		close();
+		return false;
+	}
+
+	if(header->keySize != sizeof(KeyType) || header->valueSize != sizeof(ValueType)){
+		std::cout<<path<<" has different key or value types"<<std::endl;
+		close();
+		return false;
+	}
+
+	//the file grew, but the process crashed, or mmap failed, before the new size was stored
+	if(header->fileSize < (uint64_t)st.st_size){
+		header->fileSize = st.st_size;
+		msync(_base, sizeof(struct persistent_skiplist_header_t), MS_SYNC);
+	}
+
+	if(header->dirty){
+		_recover();
+		checkpoint();
+	}
+
+	return true;
+}
+
+/*
+ * Take a checkpoint and close the file
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::close(){
+	bool success = true;
+
+	if(_base){
+		success = checkpoint();
+		munmap(_base, _header()->fileSize);
+		_base = NULL;
+	}
+
+	if(_fd >= 0){
+		::close(_fd);
+		_fd = -1;
+	}
+
+	return success;
+}
+
+/*
+ * Sync all changes to the disk, and clear the dirty mark
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::checkpoint(){
+	if(NULL == _base || 0 != msync(_base, _header()->fileSize, MS_SYNC)){
+		return false;
+	}
+
+	//the changes are on the disk before the mark is cleared
+	if(_header()->dirty){
+		_header()->dirty = 0;
+		return 0 == msync(_base, sizeof(struct persistent_skiplist_header_t), MS_SYNC);
+	}
+
+	return true;
+}
+
+/*
+ * Compute the level for a node, with the same probability as Skiplist
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int PersistentSkiplist<KeyType, ValueType, Compare>::_randomLevel(){
+	int level = __builtin_ctzll(_rand.next() | (1ULL << 63)) / SKIPLIST_LEVEL_SHIFT;
+	int limit = (_header()->currLevel < _header()->maxLevel-1) ? _header()->currLevel : _header()->maxLevel-1;
+
+	return (level < limit) ? level : limit;
+}
+
+/*
+ * Insert a node into the skiplist
+ *
+ * @param key
+ * 		the key of the node
+ * @param value
+ * 		the value of the node
+ * @param node
+ * 		the offset of the node that will be allocated in this function,
+ * 		has to be 0 when calling this function
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::insert(const KeyType& key, const ValueType& value, skiplist_offset_t* node){
+	struct persistent_skiplist_header_t* header = _header();
+	skiplist_offset_t prevNodes[PERSISTENT_SKIPLIST_MAX_LEVEL];
+	skiplist_offset_t existNode = 0, cursor = header->head, tail = 0;
+	bool duplicate;
+	int level;
+
+	if(*node != 0){
+		std::cout<<"This node is already inserted"<<std::endl;
+		return false;
+	}
+
+	_markDirty();
+	_growLevel(header->count + 1);
+
+	for(int i = (header->currLevel < header->maxLevel) ? header->currLevel : header->maxLevel-1; i >= 0; i--){
+		while( (existNode = _node(cursor)->next[i]) && _comp(_node(existNode)->key, key) < 0)
+			cursor = *_cell(_node(existNode)->tail);
+
+		prevNodes[i] = cursor;
+	}
+
+	duplicate = existNode && _comp(_node(existNode)->key, key) == 0;
+	if(duplicate){
+		//the new node goes before the nodes with the same key, and shares their tail
+		level = _node(existNode)->level;
+		tail = _node(existNode)->tail;
+	}else{
+		level = _randomLevel() + 1;
+	}
+
+	//the file may be mapped again, only offsets are kept across the allocations
+	*node = _allocate(level);
+	if(0 == *node || (0 == tail && 0 == (tail = _allocate(0)))){
+		std::cout<<"create node fail in insert"<<std::endl;
+		if(*node){
+			_deallocate(*node, level);
+			*node = 0;
+		}
+		return false;
+	}
+	header = _header();
+
+	//fill the node before it's reachable
+	node_t* newNode = _node(*node);
+	newNode->key = key;
+	newNode->value = value;
+	newNode->level = level;
+	newNode->tail = tail;
+	newNode->prev = 0;
+	if(!duplicate){
+		*_cell(tail) = *node;
+	}
+	for(int i = 0; i < level; i++){
+		newNode->next[i] = _node(prevNodes[i])->next[i];
+	}
+
+	//link from level 0 up, so an upper level never has a node that is not at level 0
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+	for(int i = 0; i < level; i++){
+		_node(prevNodes[i])->next[i] = *node;
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	if(duplicate){
+		_node(existNode)->prev = *node;
+	}
+	if(level > header->currLevel){
+		header->currLevel = level;
+	}
+	header->count++;
+
+	return true;
+}
+
+/*
+ * Remove a given node from the list
+ *
+ * @param node
+ * 		the offset of the node that needs to be removed, it's set to 0 afterwards
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::del(skiplist_offset_t* node){
+	struct persistent_skiplist_header_t* header = _header();
+	node_t* target;
+	bool lastOfKey = false;
+
+	if(0 == *node){
+		std::cout<<"This node is not inserted"<<std::endl;
+		return false;
+	}
+
+	_markDirty();
+	target = _node(*node);
+
+	if(target->prev != 0){
+		//this node is not the head of a list of nodes which have the same key
+		if(*_cell(target->tail) == *node){
+			*_cell(target->tail) = target->prev;
+		}else{
+			_node(target->next[0])->prev = target->prev;
+		}
+
+		//unlink from the top level down, level 0 is the last one
+		for(int i = target->level-1; i >= 0; i--){
+			_node(target->prev)->next[i] = target->next[i];
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		}
+	}else{
+		skiplist_offset_t prevNodes[PERSISTENT_SKIPLIST_MAX_LEVEL];
+		skiplist_offset_t existNode = 0, cursor = header->head;
+
+		for(int i = header->currLevel-1; i >= 0; i--){
+			while( (existNode = _node(cursor)->next[i]) && _comp(_node(existNode)->key, target->key) < 0)
+				cursor = *_cell(_node(existNode)->tail);
+
+			prevNodes[i] = cursor;
+		}
+
+		if(existNode != *node){
+			std::cout<<"list error"<<std::endl;
+			return false;
+		}
+
+		lastOfKey = (*_cell(target->tail) == *node);
+		if(target->next[0] && !lastOfKey){
+			_node(target->next[0])->prev = 0;
+		}
+
+		for(int i = header->currLevel-1; i >= 0; i--){
+			if(_node(prevNodes[i])->next[i] == *node){
+				_node(prevNodes[i])->next[i] = target->next[i];
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+			}
+		}
+
+		while(header->currLevel > 0 && 0 == _node(header->head)->next[header->currLevel-1]){
+			header->currLevel--;
+		}
+	}
+
+	//release the blocks after the node is unlinked
+	if(lastOfKey){
+		_deallocate(target->tail, 0);
+	}
+	_deallocate(*node, target->level);
+	header->count--;
+	*node = 0;
+
+	return true;
+}
+
+/*
+ * Search for nodes with a given key
+ *
+ * @param key
+ * 		a given key
+ * @param start
+ * 		the offset of the first node with the given key, served as an output
+ * @param end
+ * 		the offset of the last node with the given key, served as an output
+ *
+ * @return
+ * 		if nodes with the given key exist, return true, otherwise return false and *start == *end == 0
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::search(const KeyType& key, skiplist_offset_t* start, skiplist_offset_t* end){
+	skiplist_offset_t existNode = 0, cursor = _header()->head;
+
+	*start = *end = 0;
+
+	for(int i = _header()->currLevel-1; i >= 0; i--){
+		while( (existNode = _node(cursor)->next[i]) && _comp(_node(existNode)->key, key) < 0)
+			cursor = *_cell(_node(existNode)->tail);
+
+		if(existNode && _comp(_node(existNode)->key, key) == 0){
+			*start = existNode;
+			*end = *_cell(_node(existNode)->tail);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Search for nodes with keys within a given range (key1 <= key2)
+ *
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param start
+ * 		the offset of the first node with a key equal or larger than the key1, served as an output
+ * @param end
+ * 		the offset of the last node with a key equal or smaller than the key2, served as an output
+ *
+ * @return
+ * 		if nodes within the given range exist, return true, otherwise return false and *start == *end == 0
+ */
+template <class KeyType, class ValueType, class Compare>
+inline bool PersistentSkiplist<KeyType, ValueType, Compare>::search(const KeyType& key1, const KeyType& key2, skiplist_offset_t* start, skiplist_offset_t* end){
+	skiplist_offset_t existNode = 0, cursor = _header()->head;
+
+	*start = *end = 0;
+
+	if(_comp(key1, key2) > 0){
+		std::cout<<"key1: "<<key1<<" is larger than key2: "<<key2<<std::endl;
+		return false;
+	}
+
+	//the first node with a key equal or larger than the key1
+	for(int i = _header()->currLevel-1; i >= 0; i--){
+		while( (existNode = _node(cursor)->next[i]) && _comp(_node(existNode)->key, key1) < 0)
+			cursor = *_cell(_node(existNode)->tail);
+	}
+	if(0 == existNode || _comp(_node(existNode)->key, key2) > 0){
+		return false;
+	}
+	*start = existNode;
+
+	//the last node with a key equal or smaller than the key2
+	cursor = _header()->head;
+	for(int i = _header()->currLevel-1; i >= 0; i--){
+		while( (existNode = _node(cursor)->next[i]) && _comp(_node(existNode)->key, key2) <= 0)
+			cursor = *_cell(_node(existNode)->tail);
+	}
+	*end = cursor;
+
+	return true;
+}
+
+/*
+ * Get a node by its offset.
+ * The pointer is valid until the next insert, which may map the file to another address
+ */
+template <class KeyType, class ValueType, class Compare>
+inline typename PersistentSkiplist<KeyType, ValueType, Compare>::node_t* PersistentSkiplist<KeyType, ValueType, Compare>::getNode(skiplist_offset_t node){
+	return _node(node);
+}
+
+/*
+ * Get the offset of the node with the smallest key, 0 if the skiplist is empty
+ */
+template <class KeyType, class ValueType, class Compare>
+inline skiplist_offset_t PersistentSkiplist<KeyType, ValueType, Compare>::first(){
+	return _node(_header()->head)->next[0];
+}
+
+/*
+ * Get the current number of levels
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int PersistentSkiplist<KeyType, ValueType, Compare>::getCurrentLevel(){
+	return _header()->currLevel;
+}
+
+/*
+ * Get the number of nodes
+ */
+template <class KeyType, class ValueType, class Compare>
+inline int PersistentSkiplist<KeyType, ValueType, Compare>::getNodesNum(){
+	return (int)_header()->count;
+}
+
+/*
+ * Print the nodes at each level, start from the current top level to level 0
+ */
+template <class KeyType, class ValueType, class Compare>
+inline void PersistentSkiplist<KeyType, ValueType, Compare>::printList(){
+	std::cout<<"Skiplist has "<<_header()->count<<" nodes."<<std::endl;
+	for(int i = _header()->currLevel-1; i >= 0; --i){
+		int count = 0;
+		std::cout<<"level "<<i<<":"<<std::endl;
+		for(skiplist_offset_t node = _node(_header()->head)->next[i]; node; node = _node(node)->next[i]){
+			count++;
+			std::cout<<"("<<_node(node)->key<<", "<<_node(node)->value<<")";
+			std::cout<<((0 == _node(node)->next[i]) ? "\n" : "->");
+		}
+		std::cout<<"count: "<<count<<std::endl;
+	}
+	std::cout<<std::endl;
+}
+
+#endif
@@ -0,0 +1,420 @@
+/*
+  sharded_skiplist.h - Skiplists partitioned by key ranges, so writers of different ranges run in parallel.
+
+  Shard i holds the keys from split i-1 (included) to split i (excluded),
+  and each shard has its own reader-writer lock, level and count.
+  rebalance moves the splits to the quantiles of the keys sampled from an upper level of the shards.
+  Nodes may move between shards when rebalancing, so the nodes are only exposed to visitors
+  and not returned as handles.
+
+  Needs C++17 for std::shared_mutex.
+*/
+#ifndef _SHARDED_SKIPLIST_H_
+#define _SHARDED_SKIPLIST_H_
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+
+#define SHARDED_SKIPLIST_SAMPLES 1024		//default number of keys sampled to rebalance
+
+//Class for sharded Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType>, class Allocator = SkiplistSlabAllocator>
+class ShardedSkiplist{
+    public:
+		typedef Skiplist<KeyType, ValueType, Compare, Allocator> list_t;
+		typedef struct skiplist_node_t<KeyType,ValueType> node_t;
+
+    private:
+		//a shard takes a cache line of its own, so the locks of different shards are not shared
+		struct alignas(64) shard_t{
+			std::shared_mutex lock;
+			list_t* list;
+		};
+
+		typedef std::vector<KeyType> splits_t;
+
+		int _num;							//how many shards
+		shard_t* _shards;
+		std::atomic<splits_t*> _splits;		//_num-1 splits, replaced by rebalance while holding all locks
+		Compare _comp;
+
+		int _findShard(const splits_t* splits, const KeyType& key) const;
+		shard_t* _lockShard(const KeyType& key, bool exclusive);
+		void _init(int num, int maxLevel, splits_t* splits);
+
+		static void _freeSplits(void* splits){
+			delete (splits_t*)splits;
+		}
+
+		//not copyable
+		ShardedSkiplist(const ShardedSkiplist&);
+		ShardedSkiplist& operator=(const ShardedSkiplist&);
+
+    public:
+		ShardedSkiplist(int num, int maxLevel = DEFAULT_MAX_LEVEL, const Compare& comp = Compare());
+		ShardedSkiplist(const std::vector<KeyType>& splits, int maxLevel = DEFAULT_MAX_LEVEL, const Compare& comp = Compare());
+		~ShardedSkiplist();
+		bool insert(const KeyType& key, const ValueType& value);
+		bool insert(KeyType&& key, ValueType&& value);
+		bool erase(const KeyType& key);
+		template <class Visitor>
+		bool search(const KeyType& key, Visitor visit);
+		template <class Visitor>
+		int search(const KeyType& key1, const KeyType& key2, Visitor visit);
+		void rebalance(int samples = SHARDED_SKIPLIST_SAMPLES);
+		int getShardsNum();
+		int getNodesNum();
+};
+
+/*
+ * Constructor, all keys go to the first shard until rebalance
+ *
+ * @param num
+ * 		how many shards
+ * @param maxLevel
+ * 		max level of each shard
+ * @param comp
+ * 		key compare functor
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::ShardedSkiplist(int num, int maxLevel, const Compare& comp): _comp(comp){
+	_init(num, maxLevel, NULL);
+}
+
+/*
+ * Constructor with known splits
+ *
+ * @param splits
+ * 		the sorted splits between the shards, there are splits.size()+1 shards
+ * @param maxLevel
+ * 		max level of each shard
+ * @param comp
+ * 		key compare functor
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::ShardedSkiplist(const std::vector<KeyType>& splits, int maxLevel, const Compare& comp): _comp(comp){
+	_init((int)splits.size() + 1, maxLevel, new splits_t(splits));
+}
+
+/*
+ * Initialise the shards, shared by the constructors
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline void ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::_init(int num, int maxLevel, splits_t* splits){
+	_num = (num > 0) ? num : 1;
+	_shards = new shard_t[_num];
+	for(int i = 0; i < _num; i++){
+		_shards[i].list = new list_t(maxLevel, _comp);
+	}
+
+	//without splits, the first shard takes all keys
+	_splits.store(splits ? splits : new splits_t());
+}
+
+/*
+ * Default destructor, no other thread can use the skiplist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::~ShardedSkiplist(){
+	for(int i = 0; i < _num; i++){
+		delete _shards[i].list;
+	}
+	delete[] _shards;
+	delete _splits.load();
+}
+
+/*
+ * Find the shard of a key, i.e. the number of splits equal or smaller than the key
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::_findShard(const splits_t* splits, const KeyType& key) const{
+	int low = 0, high = (int)splits->size();
+
+	while(low < high){
+		int mid = (low + high) / 2;
+		if(_comp((*splits)[mid], key) <= 0){
+			low = mid + 1;
+		}else{
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/*
+ * Lock the shard of a key.
+ * The splits are read in an epoch, as rebalance may replace them,
+ * and they are checked again after the lock is taken, as the key may have moved to another shard
+ *
+ * @param key
+ * 		the key
+ * @param exclusive
+ * 		whether to take the lock for writing
+ *
+ * @return
+ * 		the locked shard
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline typename ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::shard_t* ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::_lockShard(const KeyType& key, bool exclusive){
+	SkiplistEpochGuard guard;
+
+	while(true){
+		splits_t* splits = _splits.load(std::memory_order_acquire);
+		shard_t* shard = &_shards[_findShard(splits, key)];
+
+		if(exclusive){
+			shard->lock.lock();
+		}else{
+			shard->lock.lock_shared();
+		}
+
+		if(splits == _splits.load(std::memory_order_acquire)){
+			return shard;
+		}
+
+		if(exclusive){
+			shard->lock.unlock();
+		}else{
+			shard->lock.unlock_shared();
+		}
+	}
+}
+
+/*
+ * Insert a key and its value
+ *
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::insert(const KeyType& key, const ValueType& value){
+	shard_t* shard = _lockShard(key, true);
+	node_t* node = NULL;
+	bool success = shard->list->insert(key, value, &node);
+
+	shard->lock.unlock();
+
+	return success;
+}
+
+/*
+ * Insert a key and its value, both are moved into the node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::insert(KeyType&& key, ValueType&& value){
+	shard_t* shard = _lockShard(key, true);
+	node_t* node = NULL;
+	bool success = shard->list->insert(std::move(key), std::move(value), &node);
+
+	shard->lock.unlock();
+
+	return success;
+}
+
+/*
+ * Erase a node with a given key
+ *
+ * @return
+ * 		return true if success, false if the key doesn't exist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline bool ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::erase(const KeyType& key){
+	shard_t* shard = _lockShard(key, true);
+	node_t *start, *end;
+	bool success = shard->list->search(key, &start, &end) && shard->list->del(&start);
+
+	shard->lock.unlock();
+
+	return success;
+}
+
+/*
+ * Visit the nodes with a given key
+ *
+ * @param key
+ * 		the key
+ * @param visit
+ * 		called with each node while the shard is locked for reading, it must not change the key
+ *
+ * @return
+ * 		return true if the key exists
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline bool ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::search(const KeyType& key, Visitor visit){
+	shard_t* shard = _lockShard(key, false);
+	node_t *start, *end, *node;
+	bool found = shard->list->search(key, &start, &end);
+
+	if(found){
+		list_each_sl_node(start, end, node){
+			visit(node);
+		}
+	}
+	shard->lock.unlock_shared();
+
+	return found;
+}
+
+/*
+ * Visit the nodes within a given range (key1 <= key2) in the order of the keys.
+ * The shards are visited in place one after another, each is locked for reading
+ * before the previous one is unlocked, so a rebalance can't move nodes in between
+ *
+ * @param key1
+ * 		the lower bound, included
+ * @param key2
+ * 		the upper bound, included
+ * @param visit
+ * 		called with each node while its shard is locked for reading, it must not change the key
+ *
+ * @return
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+template <class Visitor>
+inline int ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::search(const KeyType& key1, const KeyType& key2, Visitor visit){
+	shard_t* shard = _lockShard(key1, false);
+	int first = (int)(shard - _shards), last, count = 0;
+
+	if(_comp(key1, key2) > 0){
+		shard->lock.unlock_shared();
+		return 0;
+	}
+
+	//the splits don't change while a shard is locked
+	last = _findShard(_splits.load(std::memory_order_acquire), key2);
+
+	for(int i = first; ; i++){
+		node_t *start, *end, *node;
+
+		if(_shards[i].list->search(key1, key2, &start, &end)){
+			list_each_sl_node(start, end, node){
+				visit(node);
+				count++;
+			}
+		}
+
+		if(i == last){
+			_shards[i].lock.unlock_shared();
+			break;
+		}
+
+		_shards[i+1].lock.lock_shared();
+		_shards[i].lock.unlock_shared();
+	}
+
+	return count;
+}
+
+/*
+ * Move the splits to the quantiles of the keys, and move the nodes to their new shards.
+ * The keys are sampled from the highest level that has enough nodes, all shards are locked meanwhile
+ *
+ * @param samples
+ * 		about how many keys to sample, at least one per shard
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline void ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::rebalance(int samples){
+	std::vector<KeyType> sampled;
+	std::vector<node_t*> moved;
+	splits_t *splits, *oldSplits;
+	long total = 0;
+	int level = 0;
+
+	//in the same order as the range search, so they don't deadlock
+	for(int i = 0; i < _num; i++){
+		_shards[i].lock.lock();
+		total += _shards[i].list->getNodesNum();
+	}
+
+	if(_num == 1 || total == 0){
+		for(int i = _num-1; i >= 0; i--)
+			_shards[i].lock.unlock();
+		return;
+	}
+
+	//every level up has 1/2^SKIPLIST_LEVEL_SHIFT of the nodes, and a split needs a key
+	if(samples < _num)
+		samples = _num;
+	for(long expected = total >> SKIPLIST_LEVEL_SHIFT; expected >= samples; expected >>= SKIPLIST_LEVEL_SHIFT)
+		level++;
+
+	//a level may have fewer nodes than expected, then sample the level below, level 0 has all keys
+	for(; level >= 0; level--){
+		sampled.clear();
+		for(int i = 0; i < _num; i++){
+			_shards[i].list->forEachAtLevel(level, [&](node_t* node){ sampled.push_back(node->key); });
+		}
+		if((int)sampled.size() >= _num)
+			break;
+	}
+
+	splits = new splits_t();
+	for(int i = 1; i < _num; i++){
+		splits->push_back(sampled[sampled.size() * i / _num]);
+	}
+
+	//the nodes out of the new range of a shard are at its two ends
+	for(int i = 0; i < _num; i++){
+		list_t* list = _shards[i].list;
+		typename list_t::iterator it = list->begin();
+
+		moved.clear();
+		for(; i > 0 && it != list->end() && _comp(it->key, (*splits)[i-1]) < 0; ++it)
+			moved.push_back(it.node());
+		if(i < _num-1){
+			for(it = list->lower_bound((*splits)[i]); it != list->end(); ++it)
+				moved.push_back(it.node());
+		}
+
+		for(size_t j = 0; j < moved.size(); j++){
+			node_t* node = moved[j];
+			node_t* newNode = NULL;
+			KeyType key(node->key);
+			ValueType value(std::move(node->value));
+
+			list->del(&node);
+			_shards[_findShard(splits, key)].list->insert(std::move(key), std::move(value), &newNode);
+		}
+	}
+
+	//readers that found a shard by the old splits retry, the old splits are released once no reader holds them
+	oldSplits = _splits.exchange(splits, std::memory_order_acq_rel);
+	SkiplistEpoch::retire(oldSplits, _freeSplits);
+
+	for(int i = _num-1; i >= 0; i--)
+		_shards[i].lock.unlock();
+}
+
+/*
+ * Get the number of shards
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::getShardsNum(){
+	return _num;
+}
+
+/*
+ * Get the number of nodes of all shards
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator>
+inline int ShardedSkiplist<KeyType, ValueType, Compare, Allocator>::getNodesNum(){
+	int count = 0;
+
+	for(int i = 0; i < _num; i++){
+		_shards[i].lock.lock_shared();
+		count += _shards[i].list->getNodesNum();
+		_shards[i].lock.unlock_shared();
+	}
+
+	return count;
+}
+
+#endif
@@ -8,35 +8,215 @@
 #ifndef _SKIPLIST_H_
 #define _SKIPLIST_H_
 
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "skiplist_epoch.h"
 
 #define DEFAULT_MAX_LEVEL 10
+#define SKIPLIST_MAX_LEVEL_LIMIT 32	//the max level grows with the number of nodes up to this
+
+/*
+ * 1 in 2^SKIPLIST_LEVEL_SHIFT nodes of a level are at the next level too, i.e. p = 1/2, 1/4 or 1/8 for 1, 2 or 3.
+ * A larger shift has fewer links per node but more hops per level. It can be defined before including this file
+ */
+#ifndef SKIPLIST_LEVEL_SHIFT
+#define SKIPLIST_LEVEL_SHIFT 2
+#endif
+#if SKIPLIST_LEVEL_SHIFT < 1 || SKIPLIST_LEVEL_SHIFT > 3
+#error "SKIPLIST_LEVEL_SHIFT has to be 1, 2 or 3"
+#endif
+#define SKIPLIST_PARALLEL_CHUNKS 8	//chunks per thread of a parallel scan, so the threads finish at about the same time
+#define SKIPLIST_STATS_LEVELS 32	//levels in the histogram of the stats, higher levels are counted in the last one
+#define SKIPLIST_STATS_RUNS 16		//buckets of run lengths in the stats, 1, 2-3, 4-7..., longer runs are counted in the last one
+#define SKIPLIST_STATS_CACHE 16		//counters of the lists a thread has used last, which it finds without a lock
+
+/*
+ * Stats of a Skiplist are collected if SKIPLIST_ENABLE_STATS is defined before including this file,
+ * otherwise the SKIPLIST_STAT statements are compiled out
+ */
+#ifdef SKIPLIST_ENABLE_STATS
+#define SKIPLIST_STAT(statement) do{ statement; }while(0)
+#else
+#define SKIPLIST_STAT(statement) do{}while(0)
+#endif
+
+/*
+ * Every link of a Skiplist also keeps its width, i.e. how many nodes it skips, if SKIPLIST_ENABLE_RANK
+ * is defined before including this file. It makes rank, select and countRange O(log(n)),
+ * at the cost of an int per level of each node and updating the widths in insert and del
+ */
+#ifdef SKIPLIST_ENABLE_RANK
+#define SKIPLIST_RANK(statement) do{ statement; }while(0)
+#else
+#define SKIPLIST_RANK(statement) do{}while(0)
+#endif
+
+/*
+ * The searches prefetch the next nodes at the current level and the level below, and the loops over level 0
+ * prefetch the nodes ahead, if SKIPLIST_ENABLE_PREFETCH is defined before including this file.
+ * It helps lists much larger than the cache, where every hop misses the cache
+ */
+
+//operations that the stats are counted for
+enum skiplist_stat_op_t{
+	SKIPLIST_STAT_INSERT,		//insert, insertBatch and bulkLoad
+	SKIPLIST_STAT_SEARCH,		//search, searchBatch, lower_bound, upper_bound and equal_range
+	SKIPLIST_STAT_DEL,
+	SKIPLIST_STAT_OPS
+};
+
+//A snapshot of the stats of a Skiplist
+struct skiplist_stats_t{
+	uint64_t calls[SKIPLIST_STAT_OPS];		//how many keys are inserted, searched and deleted
+	uint64_t hops[SKIPLIST_STAT_OPS];		//how many times the searches move to the next node at a level
+	uint64_t compares[SKIPLIST_STAT_OPS];	//how many times the key compare functor is called
+	uint64_t levels[SKIPLIST_STATS_LEVELS];	//how many nodes have 1, 2, 3... levels
+	uint64_t nodes;							//how many nodes
+	uint64_t runs;							//how many lists of nodes that have the same key, i.e. distinct keys
+	uint64_t runLengths[SKIPLIST_STATS_RUNS];	//how many of the runs have 1, 2-3, 4-7... nodes
+	uint64_t bytes;							//bytes of the nodes and tail cells requested from the allocator
+};
+
+//Counters of the operations of one thread on a Skiplist, getStats adds up the counters of all threads.
+//Only the thread writes them, so relaxed loads and stores are enough for getStats to read them meanwhile
+struct skiplist_stat_counters_t{
+	std::thread::id thread;
+	std::atomic<uint64_t> calls[SKIPLIST_STAT_OPS];
+	std::atomic<uint64_t> hops[SKIPLIST_STAT_OPS];
+	std::atomic<uint64_t> compares[SKIPLIST_STAT_OPS];
+	int op;									//the operation that the hops and compares are counted for
+
+	static void add(std::atomic<uint64_t>& counter, uint64_t num){
+		counter.store(counter.load(std::memory_order_relaxed) + num, std::memory_order_relaxed);
+	}
+
+	//an id for the counters of a new Skiplist, ids are never reused, so a thread never takes the counters of a released list
+	static uint64_t nextId(){
+		static std::atomic<uint64_t> id(0);
+		return ++id;
+	}
+};
 
 template<class KeyType, class ValueType>
 struct skiplist_node_t{
     KeyType key;			//the key of this node
     ValueType value;    	//the value of this node
-	int level;     			//how many levels this node has, from 1 to _maxLevel
+	int level;     			//how many levels this node has, from 1 to SKIPLIST_MAX_LEVEL_LIMIT
 	struct skiplist_node_t<KeyType,ValueType>** tail;	//Pointer of a pointer that points to the tail node of a list of nodes that have the same key
 														//all nodes in that list share the same memory, 
 														//which allows us to rearrange the tail pointer of each member in one process.
 														//The last node of that list points to itself
-														//If the key is unique, then it points to the node itself as well
+														//If the key is unique, then it points to the node itself as well,
+														//through the inlineTail, so a unique key doesn't need another cache line for its tail
+	struct skiplist_node_t<KeyType,ValueType>* inlineTail;	//the tail of a unique key, always points to the node itself
 	struct skiplist_node_t<KeyType,ValueType>* prev;	//if the key is not unique, and the node is not the head os a list of nodes that have the same key
 														//it points to the prev node
 														//it is NULL if the node is the head or the key is unique
     struct skiplist_node_t<KeyType,ValueType> *next[];	//an array that holds the pointers to next nodes at each level
 };
 
+/*
+ * Prefetch the nodes that a loop over level 0 visits soon: the next one,
+ * and the next one at level 1 for a node that has it, which is a few nodes ahead.
+ * Nothing is done unless SKIPLIST_ENABLE_PREFETCH is defined
+ * 
+ * @return
+ * 		always true, so it can be called in the condition of a loop
+ */
+template <class NodeType>
+static inline bool skiplistPrefetchScan(NodeType* node){
+#ifdef SKIPLIST_ENABLE_PREFETCH
+	__builtin_prefetch(__atomic_load_n(&node->next[0], __ATOMIC_RELAXED));
+	if(node->level > 1){
+		__builtin_prefetch(__atomic_load_n(&node->next[1], __ATOMIC_RELAXED));
+	}
+#else
+	(void)node;
+#endif
+	return true;
+}
+
 /*
  * Loop through the nodes from start to end.
  * The caller has to ensure the start and end are not NULL
+ * The links are read with acquire loads, so readers of a SkiplistSwmrSync list can loop alongside the writer
  */ 
 #define list_each_sl_node(start,end,node) \
-	for(node = start, end = end->next[0];		\
-		node != end; node = node->next[0])
+	for(node = start, end = __atomic_load_n(&end->next[0], __ATOMIC_ACQUIRE);		\
+		node != end && skiplistPrefetchScan(node); node = __atomic_load_n(&node->next[0], __ATOMIC_ACQUIRE))
+
+/*
+ * Forward iterator over the nodes at level 0, i.e. all nodes from the smallest key to the largest key.
+ * It dereferences to the node, so the key and value are it->key and it->value.
+ */
+template <class NodeType>
+class SkiplistIterator{
+    private:
+		NodeType* _node;
+
+    public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename std::remove_const<NodeType>::type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef NodeType* pointer;
+		typedef NodeType& reference;
+
+		SkiplistIterator(): _node(NULL){}
+		explicit SkiplistIterator(NodeType* node): _node(node){}
+
+		//an iterator converts to a const_iterator
+		template <class OtherNodeType>
+		SkiplistIterator(const SkiplistIterator<OtherNodeType>& other): _node(other.node()){}
+
+		//the node it points to, NULL for the end
+		NodeType* node() const{
+			return _node;
+		}
+
+		reference operator*() const{
+			return *_node;
+		}
+
+		pointer operator->() const{
+			return _node;
+		}
+
+		SkiplistIterator& operator++(){
+			_node = __atomic_load_n(&_node->next[0], __ATOMIC_ACQUIRE);
+			if(_node){
+				skiplistPrefetchScan(_node);
+			}
+			return *this;
+		}
+
+		SkiplistIterator operator++(int){
+			SkiplistIterator it = *this;
+			++*this;
+			return it;
+		}
+
+		template <class OtherNodeType>
+		bool operator==(const SkiplistIterator<OtherNodeType>& other) const{
+			return _node == other.node();
+		}
+
+		template <class OtherNodeType>
+		bool operator!=(const SkiplistIterator<OtherNodeType>& other) const{
+			return _node != other.node();
+		}
+};
 
 /*
  * Default function for comparing keys. 
@@ -54,454 +234,2967 @@ struct skiplist_node_t{
  */ 
 template <class KeyType>
 int defaultCompFunc(KeyType key1,KeyType key2){
-    return key1-key2;
+    return (key1 < key2) ? -1 : ((key2 < key1) ? 1 : 0);
 }
 
-//Static variable to ensure the random seed is initialised only once
-static bool s_isRandSeedSet = false;
+/*
+ * Default key compare functor of the Skiplist, follows the same return rule as defaultCompFunc.
+ * The keys are compared by operator< and passed by reference. It has no state, so the compare is inlined into the search loops.
+ * Key types without operator< need another functor, e.g. SkiplistFuncComp with a user defined key compare function
+ */
+template <class KeyType>
+struct SkiplistDefaultComp{
+	int operator()(const KeyType& key1, const KeyType& key2) const{
+		return (key1 < key2) ? -1 : ((key2 < key1) ? 1 : 0);
+	}
+};
 
-//Class for Skiplist
-template <class KeyType, class ValueType>
-class Skiplist{
+/*
+ * Adapter that turns a user defined key compare function into a key compare functor of the Skiplist,
+ * which is what the function pointer constructor of the Skiplist takes, e.g. Skiplist<Key, Value, SkiplistFuncComp<Key> >.
+ * Func is int (*)(KeyType,KeyType) or int (*)(const KeyType&,const KeyType&)
+ */
+template <class KeyType, class Func = int (*)(KeyType,KeyType)>
+class SkiplistFuncComp{
     private:
-        int _curr_level;			//starts from 0 to _maxLevel-1
-		int _maxLevel;				//larger than 1
-        int _count;					//how many nodes in this Skiplist
-        struct skiplist_node_t<KeyType,ValueType>* _sudoHead;
-		int (*_comp)(KeyType,KeyType);		//key compare function
-		struct skiplist_node_t<KeyType,ValueType>* _createNode(KeyType key, ValueType value, int level, struct skiplist_node_t<KeyType,ValueType>** tail);
-		int _randomLevel();
+		Func _func;		//user defined key compare function
 
     public:
-		Skiplist();
-		Skiplist(int maxLevel,int (*)(KeyType,KeyType));
-		~Skiplist();
-		bool insert(KeyType key, ValueType value, struct skiplist_node_t<KeyType,ValueType>** node);
-		bool del(struct skiplist_node_t<KeyType,ValueType>** node);
-		bool search(KeyType key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
-		bool search(KeyType key1, KeyType key2, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
-		int getCurrentLevel();
-		int getNodesNum();
-		void printList();
+		SkiplistFuncComp(Func func): _func(func){}
+
+		int operator()(const KeyType& key1, const KeyType& key2) const{
+			return _func(key1, key2);
+		}
 };
 
 /*
- * Default constructor which initialises the key compare function to the defaultCompFunc
- * The KeyType has to be int (uint8_t, uint16_t...) or float(float, double...)
- * The max level is set to DEFAULT_MAX_LEVEL
- */ 
-template <class KeyType, class ValueType>
-inline Skiplist<KeyType, ValueType>::Skiplist(){
-    _curr_level = 0;
-    _count = 0;
-    _maxLevel = DEFAULT_MAX_LEVEL;
-    _comp = defaultCompFunc;
-
-	//assign memory to the _sodoHead
-    _sudoHead = (struct skiplist_node_t<KeyType,ValueType>*)malloc(sizeof(struct skiplist_node_t<KeyType,ValueType>) + _maxLevel*sizeof(struct skiplist_node_t<KeyType,ValueType>*));
+ * Key compare functor by operator< that compares keys of different types, e.g. std::string and std::string_view.
+ * It enables the lookups of the Skiplist by any type that is comparable with the key type, without converting to it
+ */
+struct SkiplistTransparentComp{
+	typedef void is_transparent;
 
-	if(NULL == _sudoHead){
-		std::cout<<"create skiplist_node_t fail when creating skiplist"<<std::endl;
+	template <class Key1, class Key2>
+	int operator()(const Key1& key1, const Key2& key2) const{
+		return (key1 < key2) ? -1 : ((key2 < key1) ? 1 : 0);
 	}
+};
 
-	//set all heads to NULL 
-    for(int i=0;i<_maxLevel;i++){
-        _sudoHead->next[i] = NULL;
-    }
+/*
+ * Adapter that turns a std::less style functor into a key compare functor of the Skiplist
+ */
+template <class KeyType, class Less = std::less<KeyType> >
+class SkiplistLessComp{
+    private:
+		Less _less;
 
-	//set random seed if not set
-	if(!s_isRandSeedSet){
-		srand48(time(0));
-		s_isRandSeedSet = true;
-	}
-}
+    public:
+		SkiplistLessComp(){}
+		SkiplistLessComp(const Less& less): _less(less){}
+
+		int operator()(const KeyType& key1, const KeyType& key2) const{
+			return _less(key1, key2) ? -1 : (_less(key2, key1) ? 1 : 0);
+		}
+};
 
 /*
- * Constructor which requires to specify the key compare function and max level
- * Therefore, the KeyType can be user defined
- * 
- * @param maxLevel
- * 		user specified max level
- * @param comp
- * 		user defined key compare function, has to follow the return rule of the default key compare function
- */ 
-template <class KeyType, class ValueType>
-inline Skiplist<KeyType, ValueType>::Skiplist(int maxLevel,int (*comp)(KeyType,KeyType)){
-    _curr_level = 0;
-    _count = 0;
-    _maxLevel = maxLevel;
-    _comp = comp;
-    _sudoHead = (struct skiplist_node_t<KeyType,ValueType>*)malloc(sizeof(struct skiplist_node_t<KeyType,ValueType>) + _maxLevel*sizeof(struct skiplist_node_t<KeyType,ValueType>*));
+ * Allocator policies of the Skiplist.
+ * An allocator policy provides four functions:
+ * 		void* allocate(size_t size, int sizeClass);
+ * 		void deallocate(void* ptr, size_t size, int sizeClass);
+ * 		void reserve(size_t size, int num);
+ * 		bool merge(Allocator& other);
+ * The sizeClass is the number of levels of a node, or 0 for the shared tail cell.
+ * The same size is always passed with the same sizeClass of a Skiplist.
+ * reserve is a hint that about num blocks of size bytes in total are going to be allocated.
+ * merge is called by split and join before nodes move between two lists, afterwards either allocator
+ * can deallocate the blocks of the other, and it returns false if that's not possible.
+ * The two allocators may be used by different threads after a merge, as the two lists of a split may be.
+ */
 
-	if(NULL == _sudoHead){
-		std::cout<<"create skiplist_node_t fail when creating skiplist"<<std::endl;
-	}
+/*
+ * Allocator policy that calls malloc/free for every node and tail cell.
+ */
+class SkiplistMallocAllocator{
+    public:
+		void* allocate(size_t size, int /*sizeClass*/){
+			return malloc(size);
+		}
 
-    for(int i=0;i<_maxLevel;i++){
-        _sudoHead->next[i] = NULL;
-    }
+		void deallocate(void* ptr, size_t /*size*/, int /*sizeClass*/){
+			free(ptr);
+		}
 
-	if(!s_isRandSeedSet){
-		srand48(time(0));
-		s_isRandSeedSet = true;
-	}
-}
+		void reserve(size_t /*size*/, int /*num*/){
+		}
+
+		bool merge(SkiplistMallocAllocator& /*other*/){
+			return true;
+		}
+};
+
+#define SKIPLIST_SLAB_CHUNK_SIZE (64*1024)	//bytes of memory requested from malloc at a time
+#define SKIPLIST_SLAB_CLASSES 64			//size classes that are recycled by the free lists
+#define SKIPLIST_SLAB_ALIGN 16				//alignment of every block
 
 /*
- * Default destructor
+ * Default allocator policy.
+ * Blocks are carved out of large chunks one after another, so nodes inserted one after another
+ * are close in memory. A freed block is pushed to the free list of its size class and reused by the next
+ * allocation of the same size class. The chunks are returned to the system when the allocator is destroyed.
+ * After a merge, the two allocators share the ownership of their chunks, which are released with the last of them.
+ * Each allocator keeps its own free lists and current chunk, and only takes a lock of the shared pool
+ * for a new chunk, so the lists split from one list can be modified by different threads.
  */
-template <class KeyType, class ValueType>
-inline Skiplist<KeyType, ValueType>::~Skiplist(){
-    free(_sudoHead);
-}
+class SkiplistSlabAllocator{
+    private:
+		struct slab_chunk_t{
+			struct slab_chunk_t* next;		//the next chunk, all chunks are linked for releasing
+		};
+
+		//the chunks owned by the allocators merged together
+		struct slab_pool_t{
+			std::mutex lock;						//guards chunks
+			struct slab_chunk_t* chunks;
+			struct slab_pool_t* merged[2];			//the pools of two allocators shared by a merge, released with this pool
+			std::atomic<int> refs;					//how many allocators and pools share the pool
+		};
+
+		struct slab_pool_t* _pool;
+		void* _freeLists[SKIPLIST_SLAB_CLASSES];	//one free list per size class, linked through the first word of a block
+		char* _bump;								//the next free byte in the current chunk
+		char* _bumpEnd;								//the end of the current chunk
+
+		static size_t _align(size_t size){
+			return (size + SKIPLIST_SLAB_ALIGN - 1) & ~((size_t)SKIPLIST_SLAB_ALIGN - 1);
+		}
+
+		static struct slab_pool_t* _newPool(){
+			struct slab_pool_t* pool = new slab_pool_t;
+
+			pool->chunks = NULL;
+			pool->merged[0] = pool->merged[1] = NULL;
+			pool->refs = 1;
+
+			return pool;
+		}
+
+		//start carving blocks from a new chunk
+		bool _newChunk(size_t size){
+			size_t header = _align(sizeof(struct slab_chunk_t));
+			struct slab_chunk_t* chunk = (struct slab_chunk_t*)malloc(header + size);
+
+			if(NULL == chunk){
+				return false;
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(_pool->lock);
+				chunk->next = _pool->chunks;
+				_pool->chunks = chunk;
+			}
+			_bump = (char*)chunk + header;
+			_bumpEnd = _bump + size;
+
+			return true;
+		}
+
+		//release a pool with the last allocator or pool sharing it, and the pools it shares
+		static void _release(struct slab_pool_t* pool){
+			std::vector<struct slab_pool_t*> pools(1, pool);
+
+			while(!pools.empty()){
+				pool = pools.back();
+				pools.pop_back();
+				if(pool->refs.fetch_sub(1) > 1){
+					continue;
+				}
+
+				while(pool->chunks){
+					struct slab_chunk_t* next = pool->chunks->next;
+					free(pool->chunks);
+					pool->chunks = next;
+				}
+				for(int i=0;i<2;i++){
+					if(pool->merged[i]){
+						pools.push_back(pool->merged[i]);
+					}
+				}
+				delete pool;
+			}
+		}
+
+		//not copyable, the pool is only shared by merge
+		SkiplistSlabAllocator(const SkiplistSlabAllocator&);
+		SkiplistSlabAllocator& operator=(const SkiplistSlabAllocator&);
+
+    public:
+		SkiplistSlabAllocator(){
+			_pool = _newPool();
+			for(int i=0;i<SKIPLIST_SLAB_CLASSES;i++){
+				_freeLists[i] = NULL;
+			}
+			_bump = _bumpEnd = NULL;
+		}
+
+		~SkiplistSlabAllocator(){
+			_release(_pool);
+		}
+
+		void* allocate(size_t size, int sizeClass){
+			size = _align(size);
+
+			//too large to be recycled, or too large for a chunk
+			if(sizeClass < 0 || sizeClass >= SKIPLIST_SLAB_CLASSES || size > SKIPLIST_SLAB_CHUNK_SIZE/4){
+				return malloc(size);
+			}
+
+			//reuse a freed block of the same size class
+			if(_freeLists[sizeClass]){
+				void* block = _freeLists[sizeClass];
+				_freeLists[sizeClass] = *(void**)block;
+				return block;
+			}
+
+			//request a new chunk if the current one is used up
+			if(_bump + size > _bumpEnd && !_newChunk(SKIPLIST_SLAB_CHUNK_SIZE)){
+				return NULL;
+			}
+
+			void* block = _bump;
+			_bump += size;
+			return block;
+		}
+
+		void deallocate(void* ptr, size_t size, int sizeClass){
+			size = _align(size);
+
+			if(sizeClass < 0 || sizeClass >= SKIPLIST_SLAB_CLASSES || size > SKIPLIST_SLAB_CHUNK_SIZE/4){
+				free(ptr);
+				return;
+			}
+
+			*(void**)ptr = _freeLists[sizeClass];
+			_freeLists[sizeClass] = ptr;
+		}
+
+		//make sure the blocks can be carved out of one chunk, so they are next to each other
+		void reserve(size_t size, int num){
+			size += (size_t)num * SKIPLIST_SLAB_ALIGN;
+
+			if(_bump + size > _bumpEnd){
+				_newChunk((size > SKIPLIST_SLAB_CHUNK_SIZE) ? size : SKIPLIST_SLAB_CHUNK_SIZE);
+			}
+		}
+
+		//share the ownership of the chunks of both allocators, the free lists and the current chunks stay apart.
+		//A pool only this allocator or the other one has is moved into the pool of the other,
+		//otherwise a new pool shares both pools
+		bool merge(SkiplistSlabAllocator& other){
+			struct slab_pool_t *from = other._pool, *to = _pool;
+
+			if(from == to){
+				return true;
+			}
+
+			if(from->refs.load() > 1){
+				from = _pool;
+				to = other._pool;
+			}
+
+			if(from->refs.load() > 1){
+				to = _newPool();
+				to->merged[0] = _pool;
+				to->merged[1] = other._pool;
+			}else{
+				std::lock_guard<std::mutex> guard(to->lock);
+
+				while(from->chunks){
+					struct slab_chunk_t* next = from->chunks->next;
+					from->chunks->next = to->chunks;
+					to->chunks = from->chunks;
+					from->chunks = next;
+				}
+				delete from;
+			}
+			to->refs++;
+			_pool = other._pool = to;
+
+			return true;
+		}
+};
 
 /*
- * Create a node with specified key, value, levels and tail
- * 
- * @param key
- * 		the key of this node
- * @param value
- * 		the value of this node
- * @param level
- * 		how many levels this node has
- * @param tail
- * 		the address of a pointer points to the tail of a list of nodes with the same key
- * 		it's NULL if the key is unique when inserting
- * 
- * @return
- * 		return the created node if success.
+ * Sync policies of the Skiplist, which decide how the links between the nodes are read and written.
+ * A sync policy provides:
+ * 		static const bool deferFree;			whether removed nodes are released after the readers have left
+ * 		static T load(const T* ptr);			read a link, a tail or a counter
+ * 		static void store(T* ptr, T value);		write a link, a tail or a counter
  */
-template <class KeyType, class ValueType>
-inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType>::_createNode(KeyType key, ValueType value, int level, struct skiplist_node_t<KeyType,ValueType>** tail){
-	struct skiplist_node_t<KeyType,ValueType>* node = (struct skiplist_node_t<KeyType,ValueType>*)malloc(sizeof(struct skiplist_node_t<KeyType,ValueType>)+ level*sizeof(struct skiplist_node_t<KeyType,ValueType>*));
-	
-	if(NULL == node){
-		std::cout<<"create skiplist_node_t fail when create node"<<std::endl;
-		return NULL;
+
+/*
+ * Sync policy of a Skiplist used by one thread at a time, the default
+ */
+struct SkiplistNoSync{
+	static const bool deferFree = false;
+
+	template <class T>
+	static T load(const T* ptr){
+		return *ptr;
 	}
-	
-	node->level = level;
-	node->key = key;
-	node->value = value;
 
-	//the prev pointer can only be not NULL when the node is the head of a list of nodes which have the same key
-	node->prev = NULL;
-	
-	//all nodes with the same key share the same memory for tail
-	if(NULL == tail){
-		node->tail = (struct skiplist_node_t<KeyType,ValueType>**)malloc(sizeof(struct skiplist_node_t<KeyType,ValueType>*));
-		*(node->tail) = node;
-	}else{
-		node->tail = tail;
+	template <class T>
+	static void store(T* ptr, T value){
+		*ptr = value;
 	}
+};
 
-	return node;
-}
+/*
+ * Sync policy of a Skiplist with a single writer thread and multiple reader threads (SWMR).
+ * The writer fills a new node before it links the node with release stores, from the top level down,
+ * and readers follow the links with acquire loads without any lock, so a reader never waits for the writer.
+ * Removed nodes and tails are released by the writer two epochs later, when no reader can hold them.
+ * Readers have to hold a SkiplistEpochGuard while they search and use the nodes found.
+ * Readers can call search, lower_bound, upper_bound, equal_range, searchBatch, begin, forEachAtLevel and the getters,
+ * the rest are for the writer. The node after a range can be removed while a reader loops to it,
+ * so readers loop over a range from lower_bound and stop by the keys instead of the end of search.
+ */
+struct SkiplistSwmrSync{
+	static const bool deferFree = true;
+
+	template <class T>
+	static T load(const T* ptr){
+		return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+	}
+
+	template <class T>
+	static void store(T* ptr, T value){
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+	}
+};
+
+//A removed node or tail waiting for the readers to leave
+struct skiplist_deferred_t{
+	void* ptr;
+	int level;			//levels of the node, 0 for a tail
+	uint64_t epoch;		//global epoch when it was removed
+};
 
 /*
- * Compute the level for a node.
- * 
- * @return 
- * 		the level
+ * Random number generator for the levels of nodes (wyrand).
+ * Every Skiplist owns one, so lists in different threads don't share a generator,
+ * and the shape of a list can be reproduced by giving the same seed.
  */
-template <class KeyType, class ValueType>
-inline int Skiplist<KeyType, ValueType>::_randomLevel(){
-	//the probability of a node has level n is (1/4)^n, i.e. every node has level 0, 1 in 4 has level 1,
-	//1 in 16 has level 2, 1 in 64 has level 3, etc.
-	unsigned int rand = lrand48() & (UINT32_MAX - 1);
-	unsigned int level = ((rand == 0) ? _maxLevel : (__builtin_ctz(rand)-1) / 2);
+class SkiplistRandom{
+    private:
+		uint64_t _state;
 
-	//restrict the levels
-	if (level > _curr_level)
-		level = _curr_level;
-	if (level >= _maxLevel)
-		level = _maxLevel-1;
+    public:
+		/*
+		 * @param seed
+		 * 		the seed, 0 to seed from the time and the address of the generator
+		 */
+		SkiplistRandom(uint64_t seed = 0){
+			this->seed(seed);
+		}
+
+		void seed(uint64_t seed){
+			if(0 == seed){
+				seed = (uint64_t)time(0) ^ ((uint64_t)(uintptr_t)this << 16);
+			}
+			_state = seed;
+		}
+
+		uint64_t next(){
+			_state += 0xa0761d6478bd642fULL;
+			__uint128_t product = (__uint128_t)_state * (_state ^ 0xe7037ed1a0b428dbULL);
+			return (uint64_t)(product >> 64) ^ (uint64_t)product;
+		}
+};
+
+/*
+ * Snapshot format of a Skiplist, written by save and read by load:
+ * 		header: struct skiplist_snapshot_header_t
+ * 		for each distinct key in level 0 order:
+ * 			the key, a zigzag varint of the difference from the previous key for integer keys, raw bytes otherwise
+ * 			a varint of how many nodes have the key
+ * 			the raw bytes of the values of those nodes
+ * The header and the raw keys and values are in the byte order of the machine that wrote the snapshot,
+ * which is recorded by the SKIPLIST_SNAPSHOT_BIG_ENDIAN flag, and load rejects a snapshot of the other byte order
+ */
+#define SKIPLIST_SNAPSHOT_MAGIC 0x50414e534c53ULL		//"SLSNAP"
+#define SKIPLIST_SNAPSHOT_VERSION 1
+#define SKIPLIST_SNAPSHOT_DELTA_KEYS 1					//flag of integer keys encoded by differences
+#define SKIPLIST_SNAPSHOT_BIG_ENDIAN 2					//flag of a snapshot written by a big endian machine
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SKIPLIST_SNAPSHOT_BYTE_ORDER SKIPLIST_SNAPSHOT_BIG_ENDIAN
+#else
+#define SKIPLIST_SNAPSHOT_BYTE_ORDER 0
+#endif
+#define SKIPLIST_SNAPSHOT_BUFFER (64*1024)				//size of the buffer between a snapshot and its stream
+
+struct skiplist_snapshot_header_t{
+	uint64_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t keySize;			//sizeof the key type
+	uint32_t valueSize;			//sizeof the value type
+	uint64_t count;				//how many nodes
+};
+
+/*
+ * Buffered writer of a snapshot, only the buffer is staged in memory
+ */
+class SkiplistSnapshotWriter{
+    private:
+		std::ostream& _out;
+		uint64_t _prevKey;			//the previous integer key
+		size_t _len;
+		char _buf[SKIPLIST_SNAPSHOT_BUFFER];
+
+    public:
+		SkiplistSnapshotWriter(std::ostream& out): _out(out), _prevKey(0), _len(0){}
+
+		void write(const void* data, size_t size){
+			if(_len + size > SKIPLIST_SNAPSHOT_BUFFER){
+				flush();
+				if(size > SKIPLIST_SNAPSHOT_BUFFER){
+					_out.write((const char*)data, size);
+					return;
+				}
+			}
+			memcpy(_buf + _len, data, size);
+			_len += size;
+		}
+
+		void writeVarint(uint64_t value){
+			if(_len + 10 > SKIPLIST_SNAPSHOT_BUFFER){
+				flush();
+			}
+			while(value >= 0x80){
+				_buf[_len++] = (char)(value | 0x80);
+				value >>= 7;
+			}
+			_buf[_len++] = (char)value;
+		}
+
+		template <class KeyType>
+		typename std::enable_if<std::is_integral<KeyType>::value>::type writeKey(const KeyType& key){
+			uint64_t delta = (uint64_t)key - _prevKey;
 
-	return level;
+			//zigzag, so small negative differences are small as well
+			writeVarint((delta << 1) ^ (uint64_t)((int64_t)delta >> 63));
+			_prevKey = (uint64_t)key;
+		}
+
+		template <class KeyType>
+		typename std::enable_if<!std::is_integral<KeyType>::value>::type writeKey(const KeyType& key){
+			write(&key, sizeof(KeyType));
+		}
+
+		bool flush(){
+			_out.write(_buf, _len);
+			_len = 0;
+			return _out.good();
+		}
+};
+
+/*
+ * Buffered reader of a snapshot
+ */
+class SkiplistSnapshotReader{
+    private:
+		std::istream& _in;
+		uint64_t _prevKey;			//the previous integer key
+		size_t _pos, _len;
+		char _buf[SKIPLIST_SNAPSHOT_BUFFER];
+
+		bool _refill(){
+			_in.read(_buf, SKIPLIST_SNAPSHOT_BUFFER);
+			_len = (size_t)_in.gcount();
+			_pos = 0;
+			return _len > 0;
+		}
+
+    public:
+		SkiplistSnapshotReader(std::istream& in): _in(in), _prevKey(0), _pos(0), _len(0){}
+
+		bool read(void* data, size_t size){
+			while(size > 0){
+				if(_pos == _len && !_refill()){
+					return false;
+				}
+
+				size_t num = (size < _len - _pos) ? size : _len - _pos;
+				memcpy(data, _buf + _pos, num);
+				_pos += num;
+				data = (char*)data + num;
+				size -= num;
+			}
+			return true;
+		}
+
+		bool readVarint(uint64_t* value){
+			*value = 0;
+			for(int shift = 0; shift < 64; shift += 7){
+				if(_pos == _len && !_refill()){
+					return false;
+				}
+
+				uint8_t byte = (uint8_t)_buf[_pos++];
+				*value |= (uint64_t)(byte & 0x7f) << shift;
+				if(byte < 0x80){
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template <class KeyType>
+		typename std::enable_if<std::is_integral<KeyType>::value, bool>::type readKey(KeyType* key){
+			uint64_t zigzag;
+
+			if(!readVarint(&zigzag)){
+				return false;
+			}
+			_prevKey += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+			*key = (KeyType)_prevKey;
+			return true;
+		}
+
+		template <class KeyType>
+		typename std::enable_if<!std::is_integral<KeyType>::value, bool>::type readKey(KeyType* key){
+			return read(key, sizeof(KeyType));
+		}
+};
+
+//Class for Skiplist
+template <class KeyType, class ValueType, class Compare = SkiplistDefaultComp<KeyType>, class Allocator = SkiplistSlabAllocator, class Sync = SkiplistNoSync>
+class Skiplist{
+    private:
+        int _curr_level;			//how many levels are in use, from 0 to _maxLevel
+		int _maxLevel;				//the highest level a new node can have, grows with the number of nodes
+        int _count;					//how many nodes in this Skiplist
+        struct skiplist_node_t<KeyType,ValueType>* _sudoHead;
+		Compare _comp;						//key compare functor
+		int (*_func)(KeyType,KeyType);		//key compare function given to the constructor with the default functor, NULL to use the functor
+		Allocator _alloc;					//allocator of the nodes and the tail cells
+		SkiplistRandom _rand;				//random number generator of the levels
+		std::vector<struct skiplist_deferred_t> _deferred;	//removed nodes and tails not released yet, only if Sync::deferFree
+#ifdef SKIPLIST_ENABLE_STATS
+		//the levels, nodes, runs and bytes, only changed by the thread that writes the list
+		struct skiplist_stats_t _stats;
+		//the operations are counted by each thread in its own counters, as readers of a SWMR list
+		//or of the shards of a ShardedSkiplist search at the same time
+		uint64_t _statsId;					//finds the counters of the list cached by a thread
+		mutable std::mutex _countersLock;
+		mutable std::vector<struct skiplist_stat_counters_t*> _counters;
+		struct skiplist_stat_counters_t* _statCounters() const;
+
+		void _statCall(int op, uint64_t num) const{
+			struct skiplist_stat_counters_t* counters = _statCounters();
+			counters->op = op;
+			skiplist_stat_counters_t::add(counters->calls[op], num);
+		}
+
+		void _statHop() const{
+			struct skiplist_stat_counters_t* counters = _statCounters();
+			skiplist_stat_counters_t::add(counters->hops[counters->op], 1);
+		}
+
+		//the bucket of a run length in the histogram
+		static int _runBucket(uint64_t length){
+			int bucket = 63 - __builtin_clzll(length);
+			return (bucket < SKIPLIST_STATS_RUNS) ? bucket : SKIPLIST_STATS_RUNS-1;
+		}
+
+		//the bucket of the run of a node which is the head of its list of nodes with the same key
+		static int _runBucket(const struct skiplist_node_t<KeyType,ValueType>* node){
+			return (node->tail == &node->inlineTail) ? 0 : _runBucket((uint64_t)*_runLength(node->tail));
+		}
+#endif
+		void _init(int maxLevel, uint64_t seed);
+		void _grow(uint64_t count);
+		template <class Key1, class Key2>
+		int _compare(const Key1& key1, const Key2& key2) const;
+		static Compare _funcComp(int (*comp)(KeyType,KeyType), std::true_type);
+		static Compare _funcComp(int (*comp)(KeyType,KeyType), std::false_type);
+
+		//the default functor, or the key compare function given instead of it
+		template <class Key1, class Key2>
+		int _callComp(const Key1& key1, const Key2& key2, std::true_type) const{
+			return _func ? _func(key1, key2) : _comp(key1, key2);
+		}
+
+		template <class Key1, class Key2>
+		int _callComp(const Key1& key1, const Key2& key2, std::false_type) const{
+			return _comp(key1, key2);
+		}
+		static size_t _nodeSize(int level);
+		static size_t _tailSize();
+		template <class Key, class... ValueArgs>
+		struct skiplist_node_t<KeyType,ValueType>* _createNode(int level, struct skiplist_node_t<KeyType,ValueType>** tail, Key&& key, ValueArgs&&... valueArgs);
+		template <class Key, class... ValueArgs>
+		bool _emplace(struct skiplist_node_t<KeyType,ValueType>** node, Key&& key, ValueArgs&&... valueArgs);
+		void _freeNode(struct skiplist_node_t<KeyType,ValueType>* node);
+		void _freeTail(struct skiplist_node_t<KeyType,ValueType>** tail);
+		void _retireNode(struct skiplist_node_t<KeyType,ValueType>* node);
+		void _retireTail(struct skiplist_node_t<KeyType,ValueType>** tail);
+		struct skiplist_node_t<KeyType,ValueType>** _sharedTail(struct skiplist_node_t<KeyType,ValueType>* node);
+		void _inlineTail(struct skiplist_node_t<KeyType,ValueType>* node);
+		void _reclaim(bool all);
+		void _moveStats(struct skiplist_node_t<KeyType,ValueType>* node, Skiplist* other);
+		void _resizeRun(struct skiplist_node_t<KeyType,ValueType>** tail, int num);
+
+		//read a link or a tail with the sync policy
+		static struct skiplist_node_t<KeyType,ValueType>* _next(const struct skiplist_node_t<KeyType,ValueType>* node, int level){
+			return Sync::load(&node->next[level]);
+		}
+
+		static struct skiplist_node_t<KeyType,ValueType>* _tail(const struct skiplist_node_t<KeyType,ValueType>* node){
+			return Sync::load(Sync::load(&node->tail));
+		}
+
+#if defined(SKIPLIST_ENABLE_RANK) || defined(SKIPLIST_ENABLE_STATS)
+		//how many nodes share a tail cell, stored after the tail pointer
+		static intptr_t* _runLength(struct skiplist_node_t<KeyType,ValueType>** tail){
+			return (intptr_t*)(tail + 1);
+		}
+#endif
+
+#ifdef SKIPLIST_ENABLE_RANK
+		//the widths of the links of a node, stored after its next[]
+		//the width of a link is the rank of the next node minus the rank of the node, the head has rank 0,
+		//and the end of the list has rank _count+1
+		static int* _widths(const struct skiplist_node_t<KeyType,ValueType>* node){
+			return (int*)(node->next + node->level);
+		}
+
+		//how many nodes the tail of a node is after the node, if the node is the head of its list of nodes with the same key
+		static int _runSkip(const struct skiplist_node_t<KeyType,ValueType>* node){
+			return (node->tail == &node->inlineTail) ? 0 : (int)*_runLength(node->tail) - 1;
+		}
+
+		template <class Key>
+		int _rank(const Key& key, bool equal) const;
+#endif
+
+		//prefetch the next nodes at a level and the level below, which a search visits next
+		static void _prefetch(const struct skiplist_node_t<KeyType,ValueType>* node, int level){
+#ifdef SKIPLIST_ENABLE_PREFETCH
+			__builtin_prefetch(__atomic_load_n(&node->next[level], __ATOMIC_RELAXED));
+			if(level > 0){
+				__builtin_prefetch(__atomic_load_n(&node->next[level-1], __ATOMIC_RELAXED));
+			}
+#else
+			(void)node;
+			(void)level;
+#endif
+		}
+		int _randomLevel();
+		template <class Key>
+		struct skiplist_node_t<KeyType,ValueType>* _lowerBound(const Key& key) const;
+		template <class Key>
+		struct skiplist_node_t<KeyType,ValueType>* _upperBound(const Key& key) const;
+		template <class Key>
+		bool _search(const Key& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
+		struct skiplist_node_t<KeyType,ValueType>* _fingerSearch(const KeyType& key, struct skiplist_node_t<KeyType,ValueType>** finger);
+		void _bulkStart(struct skiplist_node_t<KeyType,ValueType>** last);
+		bool _bulkAppend(const KeyType& key, const ValueType& value, struct skiplist_node_t<KeyType,ValueType>** last, int* distinct, struct skiplist_node_t<KeyType,ValueType>** node);
+		void _bulkFinish(struct skiplist_node_t<KeyType,ValueType>** last);
+		void _parallelBounds(const KeyType& key1, const KeyType& key2, int chunks, std::vector<struct skiplist_node_t<KeyType,ValueType>*>* bounds) const;
+		template <class Runner>
+		void _parallelRun(int chunks, int threads, Runner run) const;
+		template <class Visitor>
+		int _parallelChunk(const std::vector<struct skiplist_node_t<KeyType,ValueType>*>& bounds, int chunk, const KeyType& key2, Visitor&& visit) const;
+
+    public:
+		typedef SkiplistIterator<struct skiplist_node_t<KeyType,ValueType> > iterator;
+		typedef SkiplistIterator<const struct skiplist_node_t<KeyType,ValueType> > const_iterator;
+
+		Skiplist();
+		Skiplist(int maxLevel,int (*)(KeyType,KeyType),uint64_t seed = 0);
+		Skiplist(int maxLevel,const Compare& comp,uint64_t seed = 0);
+		~Skiplist();
+		bool insert(const KeyType& key, const ValueType& value, struct skiplist_node_t<KeyType,ValueType>** node);
+		bool insert(KeyType&& key, ValueType&& value, struct skiplist_node_t<KeyType,ValueType>** node);
+		template <class... ValueArgs>
+		bool emplace(struct skiplist_node_t<KeyType,ValueType>** node, const KeyType& key, ValueArgs&&... valueArgs);
+		template <class... ValueArgs>
+		bool emplace(struct skiplist_node_t<KeyType,ValueType>** node, KeyType&& key, ValueArgs&&... valueArgs);
+		bool del(struct skiplist_node_t<KeyType,ValueType>** node);
+		int eraseRange(const KeyType& key1, const KeyType& key2);
+		template <class Visitor>
+		int eraseRange(const KeyType& key1, const KeyType& key2, Visitor visit);
+		bool search(const KeyType& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
+		bool search(const KeyType& key1, const KeyType& key2, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
+		iterator begin();
+		const_iterator begin() const;
+		iterator end();
+		const_iterator end() const;
+		iterator lower_bound(const KeyType& key);
+		iterator upper_bound(const KeyType& key);
+		std::pair<iterator, iterator> equal_range(const KeyType& key);
+		//lookups by other key types, only if the key compare functor has is_transparent
+		template <class Key, class C = Compare, class = typename C::is_transparent>
+		bool search(const Key& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end);
+		template <class Key, class C = Compare, class = typename C::is_transparent>
+		iterator lower_bound(const Key& key);
+		template <class Key, class C = Compare, class = typename C::is_transparent>
+		iterator upper_bound(const Key& key);
+		template <class Key, class C = Compare, class = typename C::is_transparent>
+		std::pair<iterator, iterator> equal_range(const Key& key);
+		template <class KeyIterator>
+		int searchBatch(KeyIterator keys, int num, struct skiplist_node_t<KeyType,ValueType>** starts, struct skiplist_node_t<KeyType,ValueType>** ends);
+		template <class KeyIterator, class ValueIterator>
+		bool insertBatch(KeyIterator keys, ValueIterator values, int num, struct skiplist_node_t<KeyType,ValueType>** nodes);
+		template <class KeyIterator, class ValueIterator>
+		bool bulkLoad(KeyIterator keys, ValueIterator values, int num, struct skiplist_node_t<KeyType,ValueType>** nodes = NULL);
+		template <class Visitor>
+		int forEachAtLevel(int level, Visitor visit);
+		template <class Visitor>
+		int parallelForEach(const KeyType& key1, const KeyType& key2, Visitor visit, int threads = 0) const;
+		template <class Result, class Reduce, class Combine>
+		Result parallelReduce(const KeyType& key1, const KeyType& key2, Result init, Reduce reduce, Combine combine, int threads = 0) const;
+		bool split(const KeyType& key, Skiplist* other);
+		bool join(Skiplist* other);
+#ifdef SKIPLIST_ENABLE_RANK
+		int rank(const KeyType& key) const;
+		struct skiplist_node_t<KeyType,ValueType>* select(int index) const;
+		int countRange(const KeyType& key1, const KeyType& key2) const;
+#endif
+		bool save(std::ostream& out) const;
+		bool load(std::istream& in);
+		int getCurrentLevel();
+		int getNodesNum();
+		bool getStats(struct skiplist_stats_t* stats) const;
+		void resetStats();
+		void printStats();
+		void printList();
+};
+
+/*
+ * Default constructor which initialises the key compare functor to the SkiplistDefaultComp
+ * The KeyType has to support operator<, e.g. int (uint8_t, uint16_t...) or float(float, double...)
+ * The max level is set to DEFAULT_MAX_LEVEL
+ */ 
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::Skiplist(): _func(NULL){
+	_init(DEFAULT_MAX_LEVEL, 0);
+}
+
+/*
+ * Constructor which requires to specify the key compare function and max level
+ * Therefore, the KeyType can be user defined
+ * With the default Compare, the function is called instead of the functor, so Skiplist<Key, Value> s(10, func) still works,
+ * at the cost of a check of the function in each compare. Otherwise the Compare has to be constructible from SkiplistFuncComp,
+ * e.g. Skiplist<Key, Value, SkiplistFuncComp<Key> >, which calls the function without the check
+ * 
+ * @param maxLevel
+ * 		user specified initial max level, it grows with the number of nodes up to SKIPLIST_MAX_LEVEL_LIMIT
+ * @param comp
+ * 		user defined key compare function, has to follow the return rule of the default key compare function
+ * @param seed
+ * 		seed of the random levels, the same seed and operations build the same list. 0 to seed randomly
+ */ 
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::Skiplist(int maxLevel,int (*comp)(KeyType,KeyType),uint64_t seed):
+	_comp(_funcComp(comp, std::is_same<Compare, SkiplistDefaultComp<KeyType> >())),
+	_func(std::is_same<Compare, SkiplistDefaultComp<KeyType> >::value ? comp : NULL){
+	_init(maxLevel, seed);
+}
+
+/*
+ * Build the key compare functor for the function pointer constructor,
+ * the default functor is kept and the function is called instead of it
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Compare Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_funcComp(int (*comp)(KeyType,KeyType), std::true_type){
+	(void)comp;
+	return Compare();
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Compare Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_funcComp(int (*comp)(KeyType,KeyType), std::false_type){
+	static_assert(std::is_constructible<Compare, SkiplistFuncComp<KeyType> >::value,
+		"a key compare function needs the default Compare or Compare = SkiplistFuncComp<KeyType>");
+	return Compare(SkiplistFuncComp<KeyType>(comp));
+}
+
+/*
+ * Constructor which requires to specify the key compare functor and max level
+ * 
+ * @param maxLevel
+ * 		user specified initial max level, it grows with the number of nodes up to SKIPLIST_MAX_LEVEL_LIMIT
+ * @param comp
+ * 		user defined key compare functor, has to follow the return rule of the default key compare function
+ * @param seed
+ * 		seed of the random levels, the same seed and operations build the same list. 0 to seed randomly
+ */ 
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::Skiplist(int maxLevel,const Compare& comp,uint64_t seed): _comp(comp), _func(NULL){
+	_init(maxLevel, seed);
+}
+
+/*
+ * Initialise an empty skiplist, shared by the constructors
+ * 
+ * @param maxLevel
+ * 		the max level
+ * @param seed
+ * 		seed of the random levels
+ */ 
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_init(int maxLevel, uint64_t seed){
+    _curr_level = 0;
+    _count = 0;
+    _maxLevel = (maxLevel < 1) ? 1 : ((maxLevel > SKIPLIST_MAX_LEVEL_LIMIT) ? SKIPLIST_MAX_LEVEL_LIMIT : maxLevel);
+	_rand.seed(seed);
+	SKIPLIST_STAT(_stats = skiplist_stats_t(); _statsId = skiplist_stat_counters_t::nextId());
+
+	//assign memory to the _sodoHead, with all the levels the max level can grow to,
+	//so the head never moves and readers of a SWMR list don't have to check for it
+    _sudoHead = (struct skiplist_node_t<KeyType,ValueType>*)_alloc.allocate(_nodeSize(SKIPLIST_MAX_LEVEL_LIMIT), SKIPLIST_MAX_LEVEL_LIMIT);
+
+	if(NULL == _sudoHead){
+		std::cout<<"create skiplist_node_t fail when creating skiplist"<<std::endl;
+		return;
+	}
+
+	SKIPLIST_STAT(_stats.bytes += _nodeSize(SKIPLIST_MAX_LEVEL_LIMIT));
+
+	//set all heads to NULL 
+	_sudoHead->level = SKIPLIST_MAX_LEVEL_LIMIT;
+    for(int i=0;i<SKIPLIST_MAX_LEVEL_LIMIT;i++){
+        _sudoHead->next[i] = NULL;
+    }
+}
+
+/*
+ * Raise the max level for a given number of nodes.
+ * A max level of n keeps the searches O(log(n)) up to 2^(SKIPLIST_LEVEL_SHIFT*n) nodes
+ * 
+ * @param count
+ * 		the number of nodes
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_grow(uint64_t count){
+	while(_maxLevel < SKIPLIST_MAX_LEVEL_LIMIT && SKIPLIST_LEVEL_SHIFT*_maxLevel < 64 && (count >> (SKIPLIST_LEVEL_SHIFT*_maxLevel)) != 0){
+		_maxLevel++;
+	}
+}
+
+/*
+ * Compare two keys with the key compare functor, and count the call in the stats
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key1, class Key2>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_compare(const Key1& key1, const Key2& key2) const{
+	SKIPLIST_STAT(
+		struct skiplist_stat_counters_t* counters = _statCounters();
+		skiplist_stat_counters_t::add(counters->compares[counters->op], 1);
+	);
+	return _callComp(key1, key2, std::is_same<Compare, SkiplistDefaultComp<KeyType> >());
+}
+
+#ifdef SKIPLIST_ENABLE_STATS
+/*
+ * Get the counters of the operations of the calling thread on this list, created on its first operation.
+ * A thread caches the counters of the lists it used last, so it only takes the lock for a list it hasn't used lately
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline struct skiplist_stat_counters_t* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_statCounters() const{
+	static thread_local uint64_t s_ids[SKIPLIST_STATS_CACHE];
+	static thread_local struct skiplist_stat_counters_t* s_counters[SKIPLIST_STATS_CACHE];
+	int slot = (int)(_statsId % SKIPLIST_STATS_CACHE);
+	std::thread::id thread = std::this_thread::get_id();
+
+	if(s_ids[slot] == _statsId){
+		return s_counters[slot];
+	}
+
+	std::lock_guard<std::mutex> lock(_countersLock);
+	struct skiplist_stat_counters_t* counters = NULL;
+
+	//a thread id may be reused after its thread exits, then the new thread goes on with the counters
+	for(size_t i = 0; i < _counters.size() && NULL == counters; i++){
+		if(_counters[i]->thread == thread){
+			counters = _counters[i];
+		}
+	}
+	if(NULL == counters){
+		counters = new skiplist_stat_counters_t();
+		counters->thread = thread;
+		counters->op = SKIPLIST_STAT_SEARCH;
+		_counters.push_back(counters);
+	}
+
+	s_ids[slot] = _statsId;
+	s_counters[slot] = counters;
+
+	return counters;
+}
+#endif
+
+/*
+ * Default destructor
+ * Nodes that are still in the skiplist are released as well
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::~Skiplist(){
+	struct skiplist_node_t<KeyType,ValueType> *node, *next;
+
+	SKIPLIST_STAT(
+		for(size_t i = 0; i < _counters.size(); i++){
+			delete _counters[i];
+		}
+	);
+
+	if(NULL == _sudoHead){
+		return;
+	}
+
+	//the readers have left, the removed nodes can be released now
+	if(Sync::deferFree){
+		_reclaim(true);
+	}
+
+	for(node = _sudoHead->next[0]; node != NULL; node = next){
+		next = node->next[0];
+
+		//the head of a list of nodes which have the same key releases the shared tail
+		if(NULL == node->prev && node->tail != &node->inlineTail){
+			_freeTail(node->tail);
+		}
+
+		_freeNode(node);
+	}
+
+	_alloc.deallocate(_sudoHead, _nodeSize(SKIPLIST_MAX_LEVEL_LIMIT), SKIPLIST_MAX_LEVEL_LIMIT);
+}
+
+/*
+ * Compute the memory size of a node
+ * 
+ * @param level
+ * 		how many levels the node has
+ * 
+ * @return
+ * 		the size in bytes
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline size_t Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_nodeSize(int level){
+#ifdef SKIPLIST_ENABLE_RANK
+	return sizeof(struct skiplist_node_t<KeyType,ValueType>) + level*(sizeof(struct skiplist_node_t<KeyType,ValueType>*) + sizeof(int));
+#else
+	return sizeof(struct skiplist_node_t<KeyType,ValueType>) + level*sizeof(struct skiplist_node_t<KeyType,ValueType>*);
+#endif
+}
+
+/*
+ * Compute the memory size of a tail cell shared by a list of nodes with the same key,
+ * which counts the nodes as well with SKIPLIST_ENABLE_RANK or SKIPLIST_ENABLE_STATS
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline size_t Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_tailSize(){
+#if defined(SKIPLIST_ENABLE_RANK) || defined(SKIPLIST_ENABLE_STATS)
+	return sizeof(struct skiplist_node_t<KeyType,ValueType>*) + sizeof(intptr_t);
+#else
+	return sizeof(struct skiplist_node_t<KeyType,ValueType>*);
+#endif
+}
+
+/*
+ * Create a node with specified levels, tail, key and value
+ * The key and value are constructed in the node
+ * 
+ * @param level
+ * 		how many levels this node has
+ * @param tail
+ * 		the address of a pointer points to the tail of a list of nodes with the same key, see _sharedTail
+ * 		it's NULL if the key is unique when inserting, then the node uses its inline tail
+ * @param key
+ * 		the key of this node, copied or moved into the node
+ * @param valueArgs
+ * 		the arguments of the constructor of the value
+ * 
+ * @return
+ * 		return the created node if success.
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class... ValueArgs>
+inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_createNode(int level, struct skiplist_node_t<KeyType,ValueType>** tail, Key&& key, ValueArgs&&... valueArgs){
+	struct skiplist_node_t<KeyType,ValueType>* node = (struct skiplist_node_t<KeyType,ValueType>*)_alloc.allocate(_nodeSize(level), level);
+	
+	if(NULL == node){
+		std::cout<<"create skiplist_node_t fail when create node"<<std::endl;
+		return NULL;
+	}
+	
+	//the memory is raw, construct the key and the value in it,
+	//if either throws the block is released, and the key is destroyed only if it was constructed
+	bool keyBuilt = false;
+	try{
+		new (&node->key) KeyType(std::forward<Key>(key));
+		keyBuilt = true;
+		new (&node->value) ValueType(std::forward<ValueArgs>(valueArgs)...);
+	}catch(...){
+		if(keyBuilt){
+			node->key.~KeyType();
+		}
+		_alloc.deallocate(node, _nodeSize(level), level);
+		throw;
+	}
+
+	node->level = level;
+	SKIPLIST_STAT(_stats.levels[((level < SKIPLIST_STATS_LEVELS) ? level : SKIPLIST_STATS_LEVELS)-1]++;
+				  _stats.nodes++;
+				  _stats.bytes += _nodeSize(level));
+
+	//the prev pointer can only be not NULL when the node is the head of a list of nodes which have the same key
+	node->prev = NULL;
+	
+	//all nodes with the same key share the same memory for tail,
+	//a unique key uses the inline one in the node until a duplicate comes
+	node->inlineTail = node;
+	if(NULL == tail){
+		node->tail = &node->inlineTail;
+		SKIPLIST_STAT(_stats.runs++; _stats.runLengths[0]++);
+	}else{
+		node->tail = tail;
+	}
+
+	return node;
+}
+
+/*
+ * Get the tail shared by the list of nodes with the key of a given node, before a duplicate is added to it.
+ * A unique key moves from its inline tail to a tail cell here, the inline tail still points to the node,
+ * so a reader that has read the inline tail doesn't see a wrong tail
+ * 
+ * @param node
+ * 		a node of the list
+ * 
+ * @return
+ * 		the shared tail, NULL if the memory can't be allocated
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline struct skiplist_node_t<KeyType,ValueType>** Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_sharedTail(struct skiplist_node_t<KeyType,ValueType>* node){
+	struct skiplist_node_t<KeyType,ValueType>** tail;
+
+	if(node->tail != &node->inlineTail){
+		return node->tail;
+	}
+
+	tail = (struct skiplist_node_t<KeyType,ValueType>**)_alloc.allocate(_tailSize(), 0);
+	if(NULL == tail){
+		std::cout<<"create tail fail when create node"<<std::endl;
+		return NULL;
+	}
+
+	*tail = node;
+#if defined(SKIPLIST_ENABLE_RANK) || defined(SKIPLIST_ENABLE_STATS)
+	*_runLength(tail) = 1;
+#endif
+	SKIPLIST_STAT(_stats.bytes += _tailSize());
+	Sync::store(&node->tail, tail);
+
+	return tail;
+}
+
+/*
+ * Move the last node of a list of nodes with the same key back to its inline tail, and release the tail cell
+ * 
+ * @param node
+ * 		the only node left with its key
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_inlineTail(struct skiplist_node_t<KeyType,ValueType>* node){
+	struct skiplist_node_t<KeyType,ValueType>** tail = node->tail;
+
+	if(tail != &node->inlineTail){
+		Sync::store(&node->tail, &node->inlineTail);
+		_retireTail(tail);
+	}
+}
+
+/*
+ * Add nodes to, or remove nodes from, a list of nodes with the same key that shares a tail cell.
+ * The cell counts the nodes with SKIPLIST_ENABLE_RANK or SKIPLIST_ENABLE_STATS
+ * 
+ * @param tail
+ * 		the tail cell of the list
+ * @param num
+ * 		how many nodes are added, negative if removed
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_resizeRun(struct skiplist_node_t<KeyType,ValueType>** tail, int num){
+#if defined(SKIPLIST_ENABLE_RANK) || defined(SKIPLIST_ENABLE_STATS)
+	SKIPLIST_STAT(_stats.runLengths[_runBucket((uint64_t)*_runLength(tail))]--);
+	*_runLength(tail) += num;
+	SKIPLIST_STAT(_stats.runLengths[_runBucket((uint64_t)*_runLength(tail))]++);
+#else
+	(void)tail;
+	(void)num;
+#endif
+}
+
+/*
+ * Release the memory of a node
+ * 
+ * @param node
+ * 		the node to be released
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_freeNode(struct skiplist_node_t<KeyType,ValueType>* node){
+	SKIPLIST_STAT(_stats.levels[((node->level < SKIPLIST_STATS_LEVELS) ? node->level : SKIPLIST_STATS_LEVELS)-1]--;
+				  _stats.nodes--;
+				  _stats.bytes -= _nodeSize(node->level));
+	node->key.~KeyType();
+	node->value.~ValueType();
+	_alloc.deallocate(node, _nodeSize(node->level), node->level);
+}
+
+/*
+ * Release the memory of a tail shared by a list of nodes which have the same key
+ * 
+ * @param tail
+ * 		the tail to be released
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_freeTail(struct skiplist_node_t<KeyType,ValueType>** tail){
+	SKIPLIST_STAT(_stats.bytes -= _tailSize());
+	_alloc.deallocate(tail, _tailSize(), 0);
+}
+
+/*
+ * Release a node removed from the list, or defer it until no reader can hold it
+ * 
+ * @param node
+ * 		the removed node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_retireNode(struct skiplist_node_t<KeyType,ValueType>* node){
+	if(!Sync::deferFree){
+		_freeNode(node);
+		return;
+	}
+
+	struct skiplist_deferred_t deferred = {node, node->level, SkiplistEpoch::current()};
+	_deferred.push_back(deferred);
+	if(_deferred.size() % SKIPLIST_EPOCH_COLLECT_THRESHOLD == 0){
+		_reclaim(false);
+	}
+}
+
+/*
+ * Release a tail no node points to any more, or defer it until no reader can hold it
+ * 
+ * @param tail
+ * 		the tail
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_retireTail(struct skiplist_node_t<KeyType,ValueType>** tail){
+	if(!Sync::deferFree){
+		_freeTail(tail);
+		return;
+	}
+
+	struct skiplist_deferred_t deferred = {tail, 0, SkiplistEpoch::current()};
+	_deferred.push_back(deferred);
+}
+
+/*
+ * Release the deferred nodes and tails removed at least two epochs ago.
+ * It's called by the writer, so the allocator is only used by one thread
+ * 
+ * @param all
+ * 		release all of them, only when no reader is left
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_reclaim(bool all){
+	size_t kept = 0;
+	uint64_t epoch;
+
+	SkiplistEpoch::tryAdvance();
+	epoch = SkiplistEpoch::current();
+
+	for(size_t i = 0; i < _deferred.size(); i++){
+		if(all || _deferred[i].epoch + 2 <= epoch){
+			if(_deferred[i].level == 0){
+				_freeTail((struct skiplist_node_t<KeyType,ValueType>**)_deferred[i].ptr);
+			}else{
+				_freeNode((struct skiplist_node_t<KeyType,ValueType>*)_deferred[i].ptr);
+			}
+		}else{
+			_deferred[kept++] = _deferred[i];
+		}
+	}
+	_deferred.resize(kept);
+}
+
+/*
+ * Compute the level for a node.
+ * 
+ * @return 
+ * 		the level
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_randomLevel(){
+	//the probability of a node has level n is (1/2^SKIPLIST_LEVEL_SHIFT)^n, e.g. with the default (1/4)^n,
+	//every node has level 0, 1 in 4 has level 1, 1 in 16 has level 2, 1 in 64 has level 3, etc.
+	//every SKIPLIST_LEVEL_SHIFT trailing zero bits of a random word add one level, the top bit is set so the word is never 0
+	int level = __builtin_ctzll(_rand.next() | (1ULL << 63)) / SKIPLIST_LEVEL_SHIFT;
+	int limit = (_curr_level < _maxLevel-1) ? _curr_level : _maxLevel-1;
+
+	//restrict the levels
+	return (level < limit) ? level : limit;
+}
+
+/* 
+ * Insert a node into the skiplist
+ * 
+ * @param key
+ * 		the key of the node
+ * @param value
+ * 		the value of the node
+ * @param node
+ * 		the address of a pointer points to the ndoe that will be allocated memory in this function, 
+ * 		has to be NULL when calling this function
+ * 
+ * @return 
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::insert(const KeyType& key, const ValueType& value, struct skiplist_node_t<KeyType,ValueType>** node){
+	return _emplace(node, key, value);
+}
+
+/* 
+ * Insert a node into the skiplist, the key and value are moved into the node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::insert(KeyType&& key, ValueType&& value, struct skiplist_node_t<KeyType,ValueType>** node){
+	return _emplace(node, std::move(key), std::move(value));
+}
+
+/* 
+ * Insert a node into the skiplist, whose value is constructed in the node
+ * 
+ * @param node
+ * 		the address of a pointer points to the ndoe that will be allocated memory in this function, 
+ * 		has to be NULL when calling this function
+ * @param key
+ * 		the key of the node, copied into the node
+ * @param valueArgs
+ * 		the arguments of the constructor of the value
+ * 
+ * @return 
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class... ValueArgs>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::emplace(struct skiplist_node_t<KeyType,ValueType>** node, const KeyType& key, ValueArgs&&... valueArgs){
+	return _emplace(node, key, std::forward<ValueArgs>(valueArgs)...);
+}
+
+/* 
+ * Insert a node into the skiplist, the key is moved into the node and the value is constructed in the node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class... ValueArgs>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::emplace(struct skiplist_node_t<KeyType,ValueType>** node, KeyType&& key, ValueArgs&&... valueArgs){
+	return _emplace(node, std::move(key), std::forward<ValueArgs>(valueArgs)...);
+}
+
+/* 
+ * Insert a node into the skiplist, shared by insert and emplace
+ * The key is only moved into the node after the search, so it's still valid during the search
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class... ValueArgs>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_emplace(struct skiplist_node_t<KeyType,ValueType>** node, Key&& key, ValueArgs&&... valueArgs){
+	struct skiplist_node_t<KeyType,ValueType>* prevNodes[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+#ifdef SKIPLIST_ENABLE_RANK
+	int rankAt[SKIPLIST_MAX_LEVEL_LIMIT];	//the ranks of the prev nodes
+	int rank = 0;
+#endif
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_INSERT, 1));
+
+	//the *node should be NULL
+	//otherwise it is inserted
+	if(*node != NULL){
+		std::cout<<"This node is already inserted"<<std::endl;
+		return false;
+	}
+
+	_grow((uint64_t)_count + 1);
+
+	//Search for the prev nodes at each level from the top level,
+	//including the level above the current top level, which a new node may be added to
+	for(int i = (_curr_level < _maxLevel) ? _curr_level : _maxLevel-1; i >= 0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key) < 0){
+			SKIPLIST_RANK(rank += _widths(cursor)[i] + _runSkip(existNode));
+            cursor = _tail(existNode);	//Update the cursor to the tail, 
+											//as tail is either pointed to the existNode or the tail of the nodes with the same key
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+		//If the key of existNode is equal or larger than the given key,
+		//the cursor is the prev node at that level
+        prevNodes[i] = cursor;
+		SKIPLIST_RANK(rankAt[i] = rank);
+	}
+
+	//Key exists
+	if(existNode && _compare(existNode->key, key) == 0){
+		struct skiplist_node_t<KeyType,ValueType>** tail = _sharedTail(existNode);
+
+		//the nodes with the same key have the same number of levels
+		if(tail){
+			*node = _createNode(existNode->level, tail, std::forward<Key>(key), std::forward<ValueArgs>(valueArgs)...);
+		}
+
+		//insert the new node before the existNode
+		if(*node){
+			existNode->prev = *node;
+			_resizeRun(tail, 1);
+		}
+	}else{
+		//compute the number of levels
+		int level = _randomLevel();
+
+		//as level starts from 0
+		//pass level+1 to create a new node
+		*node = _createNode(level+1, NULL, std::forward<Key>(key), std::forward<ValueArgs>(valueArgs)...);
+
+		//if the level equals the current level,
+		//increase the current level, after the node is created so a key or value that throws leaves it
+		if(*node && level == _curr_level){
+			SKIPLIST_RANK(_widths(_sudoHead)[_curr_level] = _count + 1);
+			Sync::store(&_curr_level, _curr_level+1);
+		}
+	}
+
+	if(NULL == *node){
+		std::cout<<"create node fail in insert"<<std::endl;
+		return false;
+	}
+
+	//the node is filled before it's linked, so a reader that reaches it at any level can move on
+	for(int i = (*node)->level-1; i >= 0; i--){
+		(*node)->next[i] = prevNodes[i]->next[i];
+	}
+
+#ifdef SKIPLIST_ENABLE_RANK
+	//the links at the levels of the node are split by it, and the links above it are one wider
+	for(int i = _curr_level-1; i >= 0; i--){
+		if(i < (*node)->level){
+			_widths(*node)[i] = _widths(prevNodes[i])[i] - (rankAt[0] + 1 - rankAt[i]) + 1;
+			_widths(prevNodes[i])[i] = rankAt[0] + 1 - rankAt[i];
+		}else{
+			_widths(prevNodes[i])[i]++;
+		}
+	}
+#endif
+
+	//Insert the node after the prev nodes at each level,
+	//starts from the top level
+	for(int i = (*node)->level-1; i >= 0; i--){
+		Sync::store(&prevNodes[i]->next[i], *node);
+	}
+
+	Sync::store(&_count, _count+1);
+
+	return true;
+}
+
+/* 
+ * Insert nodes of a batch into the skiplist, which gives the same skiplist as calling insert for each of them.
+ * The keys are expected to be sorted from small to large, so each insertion continues from the prev nodes
+ * of the previous one instead of searching from the top. Unsorted keys are still inserted correctly,
+ * at the cost of starting over from the top.
+ * 
+ * @param keys
+ * 		an iterator of the keys
+ * @param values
+ * 		an iterator of the values, one for each key
+ * @param num
+ * 		how many nodes to insert
+ * @param nodes
+ * 		an array of num pointers to the nodes that will be allocated memory in this function,
+ * 		all of them have to be NULL when calling this function
+ * 
+ * @return 
+ * 		return true if success. If a node fails to be created, return false and
+ * 		the nodes before it stay in the skiplist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class KeyIterator, class ValueIterator>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::insertBatch(KeyIterator keys, ValueIterator values, int num, struct skiplist_node_t<KeyType,ValueType>** nodes){
+	for(int i = 0; i < num; i++){
+		if(nodes[i] != NULL){
+			std::cout<<"This node is already inserted"<<std::endl;
+			return false;
+		}
+	}
+
+#ifdef SKIPLIST_ENABLE_RANK
+	//the finger doesn't know the ranks of the prev nodes, insert one by one to keep the widths
+	for(int i = 0; i < num; i++, ++keys, ++values){
+		if(!_emplace(&nodes[i], *keys, *values)){
+			return false;
+		}
+	}
+#else
+	struct skiplist_node_t<KeyType,ValueType>* finger[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType> *existNode, *node;
+
+	_grow((uint64_t)_count + num);
+
+	for(int i = 0; i < SKIPLIST_MAX_LEVEL_LIMIT; i++){
+		finger[i] = _sudoHead;
+	}
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_INSERT, num));
+
+	//a node has 4/3 levels on average, and most keys need a tail
+	_alloc.reserve(num*(_nodeSize(1) + sizeof(struct skiplist_node_t<KeyType,ValueType>*)*4/3), num*2);
+
+	for(int i = 0; i < num; i++, ++keys, ++values){
+		existNode = _fingerSearch(*keys, finger);
+
+		//the finger holds the prev nodes at each level, the same as the prevNodes in insert
+		if(existNode && _compare(existNode->key, *keys) == 0){
+			struct skiplist_node_t<KeyType,ValueType>** tail = _sharedTail(existNode);
+
+			node = tail ? _createNode(existNode->level, tail, *keys, *values) : NULL;
+			if(node){
+				existNode->prev = node;
+				_resizeRun(tail, 1);
+			}
+		}else{
+			int level = _randomLevel();
+			if(level == _curr_level){
+				Sync::store(&_curr_level, _curr_level+1);
+			}
+			node = _createNode(level+1, NULL, *keys, *values);
+		}
+
+		if(NULL == node){
+			std::cout<<"create node fail in insertBatch"<<std::endl;
+			return false;
+		}
+
+		for(int j = node->level-1; j >= 0; j--){
+			node->next[j] = finger[j]->next[j];
+		}
+		for(int j = node->level-1; j >= 0; j--){
+			Sync::store(&finger[j]->next[j], node);
+		}
+
+		Sync::store(&_count, _count+1);
+		nodes[i] = node;
+	}
+#endif
+
+	return true;
+}
+
+/*
+ * Remove a given node from the list
+ * 
+ * @param node
+ * 		an address of a pointer points to the node that needs to be removed
+ * 
+ * @return
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::del(struct skiplist_node_t<KeyType,ValueType>** node){
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_DEL, 1));
+
+    //If the *node is NULL, means it's not inserted
+	if(NULL == *node){
+		std::cout<<"This node is not inserted"<<std::endl;
+		return false;
+	}
+
+	if((*node)->prev != NULL){
+		//this node is not the head of a list of nodes which have the same key
+
+		bool last = false;
+
+#ifdef SKIPLIST_ENABLE_RANK
+		//the links over the list of nodes at the levels above them are one narrower, find them from the top
+		struct skiplist_node_t<KeyType,ValueType> *existNode, *cursor = _sudoHead;
+		for(int i = _curr_level-1; i >= (*node)->level; i--){
+			while( (existNode = cursor->next[i]) && _compare(existNode->key, (*node)->key) < 0){
+				cursor = *existNode->tail;
+			}
+			_widths(cursor)[i]--;
+		}
+		for(int i = (*node)->level-1; i >= 0; i--){
+			_widths((*node)->prev)[i] += _widths(*node)[i] - 1;
+		}
+#endif
+		_resizeRun((*node)->tail, -1);
+
+		if(*(*node)->tail == *node){
+			//if this node is the tail of a list of nodes which have the same key
+			//change the tail pointer of all nodes in this list
+			Sync::store((*node)->prev->tail, (*node)->prev);
+			last = (NULL == (*node)->prev->prev);
+		}else{
+			//otherwise this node is one in the middle
+			//rearrange the prev pointer
+			(*node)->next[0]->prev = (*node)->prev;
+		}
+
+		//update the next pointers of the prev nodes from the top level
+		for(int i = (*node)->level-1; i >= 0; i--){
+			Sync::store(&(*node)->prev->next[i], (*node)->next[i]);
+		}
+
+		//the prev node is the only one left with the key
+		if(last){
+			_inlineTail((*node)->prev);
+		}
+	}else{
+		//this node is the head of a list of nodes which have the same key
+		//or the key of this node is unique in the skiplist
+		struct skiplist_node_t<KeyType,ValueType>* prevNodes[SKIPLIST_MAX_LEVEL_LIMIT];
+		struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+
+		//search for the prev nodes at each level
+		for(int i = _curr_level-1; i >= 0; i--){
+			while( (existNode = _next(cursor, i)) && _compare(existNode->key, (*node)->key) < 0){
+           		cursor = _tail(existNode);
+				_prefetch(cursor, i);
+				SKIPLIST_STAT(_statHop());
+			}
+
+        	prevNodes[i] = cursor;
+		}
+
+		//if the found node is not the node that we want to remove, something went wrong
+		if(existNode != *node){
+			std::cout<<"list error"<<std::endl;
+			return false;
+		}
+
+		if((*node)->next[0]){
+			//update the prev pointer of the following node to NULL
+			//as the next[0] can only be a head of a list of nodes which have the same key
+			//or the key of next[0] is unique in the skiplist
+			(*node)->next[0]->prev = NULL;	
+		}
+			
+		//update the next pointers of the prev nodes from the top level
+		for(int i = _curr_level-1; i >= 0; i--)
+    	{
+			if(prevNodes[i]->next[i] == *node)
+			{
+				Sync::store(&prevNodes[i]->next[i], (*node)->next[i]);
+				SKIPLIST_RANK(_widths(prevNodes[i])[i] += _widths(*node)[i] - 1);
+				
+				//if the removed node is the last one at a level, lower down the current level
+				if(_sudoHead->next[i]==NULL)
+					Sync::store(&_curr_level, _curr_level-1);
+			}else{
+				SKIPLIST_RANK(_widths(prevNodes[i])[i]--);
+			}
+    	}
+
+		//if this node is the only one has the key in the skiplist, free the tail if it's not inline,
+		//otherwise the tail is still shared by the following nodes, unless only the next node is left
+		if(*(*node)->tail == *node){
+			SKIPLIST_STAT(_stats.runs--; _stats.runLengths[_runBucket(*node)]--);
+			if((*node)->tail != &(*node)->inlineTail){
+				_retireTail((*node)->tail);
+			}
+		}else{
+			_resizeRun((*node)->tail, -1);
+			if(*(*node)->tail == (*node)->next[0]){
+				_inlineTail((*node)->next[0]);
+			}
+		}
+	}
+
+	Sync::store(&_count, _count-1);
+	//readers may still be on the node, it's released once they have left
+	_retireNode(*node);
+	//point the *node to NULL, so we can reinsert
+	*node = NULL;
+
+	return true;
+}
+
+/*
+ * Remove all nodes with keys within a given range (key1 <= key2) in one pass.
+ * The prev nodes of both ends are searched once, each level is linked across the range,
+ * then the removed nodes and their tails are released in a walk at level 0.
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * 
+ * @return
+ * 		how many nodes are removed, 0 if key1 is larger than key2
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::eraseRange(const KeyType& key1, const KeyType& key2){
+	return eraseRange(key1, key2, [](struct skiplist_node_t<KeyType,ValueType>*){});
+}
+
+/*
+ * Remove all nodes with keys within a given range (key1 <= key2) in one pass, and visit each of them before it's released.
+ * The pointers to the removed nodes returned by insert can't be passed to del afterwards,
+ * the visitor is where the caller drops them, e.g. by setting them to NULL so they can be reinserted.
+ * With a SWMR sync policy, the nodes are released after the readers have left, like del
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param visit
+ * 		called with each removed node from the smallest key to the largest key, after it's unlinked
+ * 
+ * @return
+ * 		how many nodes are removed, 0 if key1 is larger than key2
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Visitor>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::eraseRange(const KeyType& key1, const KeyType& key2, Visitor visit){
+	struct skiplist_node_t<KeyType,ValueType> *startNodes[SKIPLIST_MAX_LEVEL_LIMIT], *endNodes[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType> *existNode, *cursor, *node, *next, *stop;
+	int removed = 0;
+#ifdef SKIPLIST_ENABLE_RANK
+	int startRanks[SKIPLIST_MAX_LEVEL_LIMIT], endRanks[SKIPLIST_MAX_LEVEL_LIMIT];	//the ranks of the prev nodes
+	int rank;
+#endif
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_DEL, 1));
+
+	if(_compare(key1, key2) > 0){
+		return 0;
+	}
+
+	//the last nodes before the range at each level
+	cursor = _sudoHead;
+	SKIPLIST_RANK(rank = 0);
+	for(int i = _curr_level-1; i >= 0; i--){
+		while( (existNode = cursor->next[i]) && _compare(existNode->key, key1) < 0){
+			SKIPLIST_RANK(rank += _widths(cursor)[i] + _runSkip(existNode));
+			cursor = *existNode->tail;
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+		startNodes[i] = cursor;
+		SKIPLIST_RANK(startRanks[i] = rank);
+	}
+
+	//the last nodes within the range at each level, which are not before the ones above
+	cursor = _sudoHead;
+	SKIPLIST_RANK(rank = 0);
+	for(int i = _curr_level-1; i >= 0; i--){
+		if(cursor == _sudoHead || (startNodes[i] != _sudoHead && _compare(cursor->key, startNodes[i]->key) < 0)){
+			cursor = startNodes[i];
+			SKIPLIST_RANK(rank = startRanks[i]);
+		}
+		while( (existNode = cursor->next[i]) && _compare(existNode->key, key2) <= 0){
+			SKIPLIST_RANK(rank += _widths(cursor)[i] + _runSkip(existNode));
+			cursor = *existNode->tail;
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+		endNodes[i] = cursor;
+		SKIPLIST_RANK(endRanks[i] = rank);
+	}
+
+	if(_curr_level == 0 || startNodes[0] == endNodes[0]){
+		return 0;
+	}
+	node = startNodes[0]->next[0];
+	stop = endNodes[0]->next[0];
+
+	//link each level across the range from the top level, the removed nodes still link to the nodes after the range,
+	//so readers on them can go on
+	SKIPLIST_RANK(removed = endRanks[0] - startRanks[0]);
+	for(int i = _curr_level-1; i >= 0; i--){
+		SKIPLIST_RANK(_widths(startNodes[i])[i] = endRanks[i] + _widths(endNodes[i])[i] - removed - startRanks[i]);
+		if(startNodes[i] != endNodes[i]){
+			Sync::store(&startNodes[i]->next[i], endNodes[i]->next[i]);
+		}
+	}
+	while(_curr_level > 0 && NULL == _sudoHead->next[_curr_level-1]){
+		Sync::store(&_curr_level, _curr_level-1);
+	}
+
+	//release the removed nodes, the head of each list of nodes with the same key releases the shared tail
+	for(removed = 0; node != stop; node = next, removed++){
+		next = node->next[0];
+		visit(node);
+
+		if(NULL == node->prev){
+			SKIPLIST_STAT(_stats.runs--; _stats.runLengths[_runBucket(node)]--);
+			if(node->tail != &node->inlineTail){
+				_retireTail(node->tail);
+			}
+		}
+		_retireNode(node);
+	}
+	Sync::store(&_count, _count - removed);
+
+	return removed;
+}
+
+/*
+ * Search for nodes with a given key
+ * There might be multiple nodes with the same key
+ * If nodes with the key exist, the *start and *end are not NULL. 
+ * User don't need to check whether they are NULL if the marco: list_each_sl_node is called to loop through the output
+ * 
+ * @param key
+ * 		a given key
+ * @param start
+ * 		An address of a pointer points to the start of a list of nodes with the given key, served as an output
+ * @param end 
+ * 		An address of a pointer points to the tail of a list of nodes with the given key, served as an output
+ * 
+ * @return 
+ * 		if nodes with the given key exist, return true and the *start and *end are not NULL,
+ * 		otherwise return false, and the *start == *end == NULL
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::search(const KeyType& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
+	return _search(key, start, end);
+}
+
+/*
+ * Search for nodes with a key of another type, which the key compare functor compares with the keys.
+ * Only available if the key compare functor has is_transparent, e.g. SkiplistTransparentComp
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class C, class>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::search(const Key& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
+	return _search(key, start, end);
+}
+
+/*
+ * Search for nodes with a given key, shared by the searches
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_search(const Key& key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
+
+	//set the *start and *end to NULL
+	*start = *end = NULL;
+
+	//Search for nodes have the given key from the top
+	for(int i=Sync::load(&_curr_level)-1; i>=0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key) < 0){
+            cursor = _tail(existNode);
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+
+		//stop if found
+        if(existNode && _compare(existNode->key, key) == 0){
+			*start = existNode;
+			*end = _tail(existNode);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Search for nodes with keys within a given range (key1 <= key2)
+ * It can be a rough range, i.e. the key1 and key2 don't need to be in the skiplist
+ * There might be multiple nodes with the same key
+ * If there are nodes within the given range, the *start and *end are not NULL
+ * User don't need to check whether they are NULL if the marco: list_each_sl_node is called to loop through the output
+ * Only one search goes down from the top, the key2 is searched from the prev nodes of the key1
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param start
+ * 		An address of a pointer points to the first node with a key equal or larger than the key1, served as an output
+ * @param end 
+ * 		An address of a pointer points to the last node with a key equal or smaller than the key2, served as an output
+ * 
+ * @return 
+ * 		if nodes within the given range exist, return true and the *start and *end are not NULL,
+ * 		otherwise return false, and the *start == *end == NULL
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::search(const KeyType& key1, const KeyType& key2, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
+	struct skiplist_node_t<KeyType,ValueType>* finger[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType>* existNode;
+
+	//set the *start and *end to NULL
+	*start = *end = NULL;
+
+	//downgrade to normal search
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 0));
+	if(_compare(key1, key2) == 0)
+		return search(key1, start, end);
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
+	
+	if(_compare(key1, key2) > 0){
+		std::cout<<"key1: "<<key1<<" is larger than key2: "<<key2<<std::endl;
+		return false;
+	}
+
+	for(int i = 0; i < SKIPLIST_MAX_LEVEL_LIMIT; i++){
+		finger[i] = _sudoHead;
+	}
+
+	//the node that has key equals to the key1 or just larger than key1
+	existNode = _fingerSearch(key1, finger);
+	if(NULL == existNode || _compare(existNode->key, key2) > 0){
+		return false;
+	}
+	*start = existNode;
+
+	//continue from the prev nodes of the key1 to the first node with a key equal or larger than the key2
+	existNode = _fingerSearch(key2, finger);
+	if(existNode && _compare(existNode->key, key2) == 0){
+		//key2 exists, end at the tail of the nodes with key2
+		*end = _tail(existNode);
+	}else{
+		//otherwise end at the prev node at level 0, whose key is just smaller than the key2
+		*end = finger[0];
+	}
+
+	return true;
+}
+
+/*
+ * Search for the first node with a key equal or larger than a given key
+ * 
+ * @param key
+ * 		a given key
+ * 
+ * @return
+ * 		the node, NULL if there isn't one
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key>
+inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_lowerBound(const Key& key) const{
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
+
+	for(int i=Sync::load(&_curr_level)-1; i>=0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key) < 0){
+            cursor = _tail(existNode);
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+	}
+
+	return existNode;
+}
+
+/*
+ * Search for the first node with a key larger than a given key
+ * 
+ * @param key
+ * 		a given key
+ * 
+ * @return
+ * 		the node, NULL if there isn't one
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key>
+inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_upperBound(const Key& key) const{
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
+
+	for(int i=Sync::load(&_curr_level)-1; i>=0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key) <= 0){
+            cursor = _tail(existNode);
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+	}
+
+	return existNode;
+}
+
+/*
+ * Get an iterator to the first node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::begin(){
+	return iterator(_next(_sudoHead, 0));
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::const_iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::begin() const{
+	return const_iterator(_next(_sudoHead, 0));
+}
+
+/*
+ * Get an iterator past the last node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::end(){
+	return iterator(NULL);
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::const_iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::end() const{
+	return const_iterator(NULL);
+}
+
+/*
+ * Get an iterator to the first node with a key equal or larger than a given key
+ * 
+ * @param key
+ * 		a given key
+ * 
+ * @return
+ * 		the iterator, end() if there isn't such a node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::lower_bound(const KeyType& key){
+	return iterator(_lowerBound(key));
+}
+
+/*
+ * Get an iterator to the first node with a key larger than a given key
+ * 
+ * @param key
+ * 		a given key
+ * 
+ * @return
+ * 		the iterator, end() if there isn't such a node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::upper_bound(const KeyType& key){
+	return iterator(_upperBound(key));
+}
+
+/*
+ * Get the range of nodes with a given key with one search,
+ * the end of the range is found through the tail of the nodes with the key
+ * 
+ * @param key
+ * 		a given key
+ * 
+ * @return
+ * 		the lower_bound and upper_bound of the key, both are the same if the key doesn't exist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline std::pair<typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator, typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator> Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::equal_range(const KeyType& key){
+	struct skiplist_node_t<KeyType,ValueType>* existNode = _lowerBound(key);
+
+	if(existNode && _compare(existNode->key, key) == 0){
+		return std::make_pair(iterator(existNode), iterator(_next(_tail(existNode), 0)));
+	}
+
+	return std::make_pair(iterator(existNode), iterator(existNode));
+}
+
+/*
+ * lower_bound, upper_bound and equal_range by a key of another type.
+ * Only available if the key compare functor has is_transparent, e.g. SkiplistTransparentComp
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class C, class>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::lower_bound(const Key& key){
+	return iterator(_lowerBound(key));
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class C, class>
+inline typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::upper_bound(const Key& key){
+	return iterator(_upperBound(key));
+}
+
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key, class C, class>
+inline std::pair<typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator, typename Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::iterator> Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::equal_range(const Key& key){
+	struct skiplist_node_t<KeyType,ValueType>* existNode = _lowerBound(key);
+
+	if(existNode && _compare(existNode->key, key) == 0){
+		return std::make_pair(iterator(existNode), iterator(_next(_tail(existNode), 0)));
+	}
+
+	return std::make_pair(iterator(existNode), iterator(existNode));
+}
+
+/*
+ * Search for the first node with a key equal or larger than a given key, starting from a finger,
+ * i.e. the prev nodes at each level of the previously searched key.
+ * The search only climbs as high as needed from the finger, so searching keys close to each other costs a few hops.
+ * If the given key is smaller than the previously searched key, the search restarts from the _sudoHead.
+ * 
+ * @param key
+ * 		a given key
+ * @param finger
+ * 		the prev nodes at each level, which are updated to the prev nodes of the given key by this function.
+ * 		All of them should point to the _sudoHead before the first search
+ * 
+ * @return
+ * 		the first node with a key equal or larger than the given key, NULL if there isn't one
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_fingerSearch(const KeyType& key, struct skiplist_node_t<KeyType,ValueType>** finger){
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor;
+	int level = 0;
+
+	//the finger is behind the key, start over
+	if(finger[0] != _sudoHead && _compare(finger[0]->key, key) >= 0){
+		for(int i = 0; i < SKIPLIST_MAX_LEVEL_LIMIT; i++){
+			finger[i] = _sudoHead;
+		}
+	}
+
+	//climb while the next node at the upper level is still smaller than the key
+	while(level < Sync::load(&_curr_level)-1 && (existNode = _next(finger[level+1], level+1)) && _compare(existNode->key, key) < 0){
+		level++;
+		SKIPLIST_STAT(_statHop());
+	}
+
+	//go down from there, the prev nodes above the level are still the prev nodes of the given key
+	cursor = finger[level];
+	for(int i = level; i >= 0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key) < 0){
+			cursor = _tail(existNode);
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+
+		finger[i] = cursor;
+	}
+
+	return existNode;
+}
+
+/*
+ * Search for nodes with each of the given keys.
+ * The keys are expected to be sorted from small to large, so each search continues from the previous one.
+ * Unsorted keys are still found, at the cost of starting over from the top.
+ * 
+ * @param keys
+ * 		an iterator of the keys
+ * @param num
+ * 		how many keys to search for
+ * @param starts
+ * 		an array of num pointers to the start of a list of nodes with each key, served as an output
+ * @param ends
+ * 		an array of num pointers to the tail of a list of nodes with each key, served as an output
+ * 
+ * @return 
+ * 		how many keys are found, the starts and ends of keys that are not found are NULL
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class KeyIterator>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::searchBatch(KeyIterator keys, int num, struct skiplist_node_t<KeyType,ValueType>** starts, struct skiplist_node_t<KeyType,ValueType>** ends){
+	struct skiplist_node_t<KeyType,ValueType>* finger[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType>* existNode;
+	int found = 0;
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, num));
+
+	for(int i = 0; i < SKIPLIST_MAX_LEVEL_LIMIT; i++){
+		finger[i] = _sudoHead;
+	}
+
+	for(int i = 0; i < num; i++, ++keys){
+		existNode = _fingerSearch(*keys, finger);
+
+		if(existNode && _compare(existNode->key, *keys) == 0){
+			starts[i] = existNode;
+			ends[i] = _tail(existNode);
+			found++;
+		}else{
+			starts[i] = ends[i] = NULL;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Start appending to an empty skiplist, the last nodes at each level are the head.
+ * With SKIPLIST_ENABLE_RANK, the width of the last link at each level is the rank of its node until _bulkFinish
+ * 
+ * @param last
+ * 		the last nodes at each level, served as an output
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_bulkStart(struct skiplist_node_t<KeyType,ValueType>** last){
+	for(int i = 0; i < SKIPLIST_MAX_LEVEL_LIMIT; i++){
+		last[i] = _sudoHead;
+		SKIPLIST_RANK(_widths(_sudoHead)[i] = 0);
+	}
+}
+
+/*
+ * Append a node after all nodes of a skiplist which is being bulk loaded.
+ * The level of the node is decided by how many distinct keys are appended:
+ * with the default SKIPLIST_LEVEL_SHIFT, every 4th distinct key has level 1, every 16th has level 2, etc,
+ * which is the same probability as the random levels.
+ * 
+ * @param key
+ * 		the key of the node, has to be equal or larger than the key of the last node
+ * @param value
+ * 		the value of the node
+ * @param last
+ * 		the last node at each level, updated by this function
+ * @param distinct
+ * 		how many distinct keys are appended, updated by this function
+ * @param node
+ * 		the address of a pointer points to the appended node, served as an output
+ * 
+ * @return
+ * 		return true if success, false if the key is smaller than the key of the last node
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_bulkAppend(const KeyType& key, const ValueType& value, struct skiplist_node_t<KeyType,ValueType>** last, int* distinct, struct skiplist_node_t<KeyType,ValueType>** node){
+	int comp = (last[0] == _sudoHead) ? 1 : _compare(key, last[0]->key);
+
+	if(comp < 0){
+		std::cout<<"keys are not sorted when bulk loading"<<std::endl;
+		return false;
+	}
+
+	if(comp == 0){
+		//append the node to the tail of the list of nodes which have the same key
+		struct skiplist_node_t<KeyType,ValueType>** tail = _sharedTail(last[0]);
+
+		*node = tail ? _createNode(last[0]->level, tail, key, value) : NULL;
+		if(NULL == *node){
+			return false;
+		}
+
+		(*node)->prev = last[0];
+		_resizeRun(tail, 1);
+	}else{
+		(*distinct)++;
+
+		int level = __builtin_ctz(*distinct) / SKIPLIST_LEVEL_SHIFT;
+		if(level >= _maxLevel)
+			level = _maxLevel-1;
+
+		*node = _createNode(level+1, NULL, key, value);
+		if(NULL == *node){
+			return false;
+		}
+	}
+
+	//link the node after the last node at each level
+	for(int i = 0; i < (*node)->level; i++){
+		(*node)->next[i] = NULL;
+		//while loading, the width of the last link at a level is the rank of its node, see _bulkStart
+		SKIPLIST_RANK(_widths(last[i])[i] = _count + 1 - _widths(last[i])[i];
+					  _widths(*node)[i] = _count + 1);
+	}
+	for(int i = 0; i < (*node)->level; i++){
+		Sync::store(&last[i]->next[i], *node);
+		last[i] = *node;
+	}
+
+	//the node becomes the tail of its key after it's linked
+	if(comp == 0){
+		Sync::store((*node)->tail, *node);
+	}
+
+	if((*node)->level > _curr_level){
+		Sync::store(&_curr_level, (*node)->level);
+	}
+	Sync::store(&_count, _count+1);
+
+	return true;
+}
+
+/*
+ * Finish appending, the last links at each level end at the end of the list
+ * 
+ * @param last
+ * 		the last nodes at each level
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_bulkFinish(struct skiplist_node_t<KeyType,ValueType>** last){
+	SKIPLIST_RANK(
+		for(int i = 0; i < _curr_level; i++){
+			_widths(last[i])[i] = _count + 1 - _widths(last[i])[i];
+		}
+	);
+	(void)last;
+}
+
+/*
+ * Build an empty skiplist from sorted keys and values in one pass, without searching.
+ * The levels are assigned deterministically, so the skiplist is perfectly balanced.
+ * Nodes with the same key keep their order in the input.
+ * 
+ * @param keys
+ * 		an iterator of the keys, sorted from small to large
+ * @param values
+ * 		an iterator of the values, one for each key
+ * @param num
+ * 		how many nodes to load
+ * @param nodes
+ * 		an array of num pointers to the loaded nodes, which can be passed to del, served as an output.
+ * 		It can be NULL if the nodes are not needed
+ * 
+ * @return
+ * 		return true if success. If the keys are not sorted, return false and
+ * 		the nodes before the first unsorted key stay in the skiplist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class KeyIterator, class ValueIterator>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::bulkLoad(KeyIterator keys, ValueIterator values, int num, struct skiplist_node_t<KeyType,ValueType>** nodes){
+	struct skiplist_node_t<KeyType,ValueType>* last[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType>* node;
+	int distinct = 0;
+
+	if(_count != 0){
+		std::cout<<"The skiplist is not empty"<<std::endl;
+		return false;
+	}
+
+	_grow(num);
+	_bulkStart(last);
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_INSERT, num));
+
+	for(int i = 0; i < num; i++, ++keys, ++values){
+		if(!_bulkAppend(*keys, *values, last, &distinct, &node)){
+			_bulkFinish(last);
+			if(nodes){
+				for(; i < num; i++){
+					nodes[i] = NULL;
+				}
+			}
+			return false;
+		}
+
+		if(nodes){
+			nodes[i] = node;
+		}
+	}
+	_bulkFinish(last);
+
+	return true;
+}
+
+/*
+ * Visit the nodes at a given level from the smallest key to the largest key.
+ * A node is at level n with the probability of (1/2^SKIPLIST_LEVEL_SHIFT)^n, so an upper level is a sample of the keys
+ * 
+ * @param level
+ * 		the level, from 0 to getCurrentLevel()-1
+ * @param visit
+ * 		called with each node
+ * 
+ * @return 
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Visitor>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::forEachAtLevel(int level, Visitor visit){
+	int count = 0;
+
+	if(level < 0 || level >= Sync::load(&_curr_level)){
+		return 0;
+	}
+
+	for(struct skiplist_node_t<KeyType,ValueType>* node = _next(_sudoHead, level); node != NULL; node = _next(node, level)){
+		visit(node);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Find the start nodes of the chunks of a range for a parallel scan.
+ * The nodes at an upper level are spread evenly over the list, so the lowest level with enough nodes
+ * in the range above level 0 gives the starts. Only the head of a list of nodes with the same key starts a chunk,
+ * so a chunk can stop by the key of the next start as well
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param chunks
+ * 		how many chunks are wanted
+ * @param bounds
+ * 		the start nodes of the chunks, followed by the first node after the range or NULL, served as an output.
+ * 		It's empty if no node is in the range
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_parallelBounds(const KeyType& key1, const KeyType& key2, int chunks, std::vector<struct skiplist_node_t<KeyType,ValueType>*>* bounds) const{
+	struct skiplist_node_t<KeyType,ValueType>* prevNodes[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead, *start;
+	int level = Sync::load(&_curr_level);
+
+	bounds->clear();
+
+	for(int i=level-1; i>=0; i--){
+		while( (existNode = _next(cursor, i)) && _compare(existNode->key, key1) < 0){
+			cursor = _tail(existNode);
+		}
+		prevNodes[i] = cursor;
+	}
+
+	start = existNode;
+	if(NULL == start || _compare(start->key, key2) > 0){
+		return;
+	}
+
+	//from the top level down, until a level has enough starts
+	for(int i=level-1; i>=1 && (int)bounds->size() < chunks; i--){
+		bounds->clear();
+		bounds->push_back(start);
+		for(existNode = _next(prevNodes[i], i); existNode && _compare(existNode->key, key2) <= 0; existNode = _next(existNode, i)){
+			if(_compare(existNode->key, bounds->back()->key) > 0){
+				bounds->push_back(existNode);
+			}
+		}
+	}
+
+	if(bounds->empty()){
+		bounds->push_back(start);
+	}
+	bounds->push_back(_upperBound(key2));
+}
+
+/*
+ * Run a function on every chunk of a parallel scan, by the calling thread and threads-1 more threads,
+ * each of them takes the next chunk from a shared counter when it's done with one
+ * 
+ * @param chunks
+ * 		how many chunks
+ * @param threads
+ * 		how many threads
+ * @param run
+ * 		called with the index of each chunk
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Runner>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_parallelRun(int chunks, int threads, Runner run) const{
+	std::atomic<int> next(0);
+	std::vector<std::thread> workers;
+	auto work = [&](){
+		for(int chunk = next.fetch_add(1); chunk < chunks; chunk = next.fetch_add(1)){
+			run(chunk);
+		}
+	};
+
+	if(threads > chunks){
+		threads = chunks;
+	}
+	for(int i = 1; i < threads; i++){
+		workers.emplace_back(work);
+	}
+	work();
+	for(size_t i = 0; i < workers.size(); i++){
+		workers[i].join();
+	}
+}
+
+/*
+ * Visit the nodes of one chunk of a parallel scan
+ * 
+ * @param bounds
+ * 		the start nodes of the chunks, see _parallelBounds
+ * @param chunk
+ * 		the index of the chunk
+ * @param key2
+ * 		the upper bound of the range, included
+ * @param visit
+ * 		called with each node
+ * 
+ * @return
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Visitor>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_parallelChunk(const std::vector<struct skiplist_node_t<KeyType,ValueType>*>& bounds, int chunk, const KeyType& key2, Visitor&& visit) const{
+	struct skiplist_node_t<KeyType,ValueType> *node, *end = bounds[chunk+1];
+	bool last = (chunk+2 == (int)bounds.size());
+	int count = 0;
+
+	for(node = bounds[chunk]; node != end && skiplistPrefetchScan(node); node = _next(node, 0)){
+		//the writer of a SWMR list may remove the next start, stop by its key instead
+		if(Sync::deferFree && (last ? _compare(node->key, key2) > 0 : _compare(node->key, end->key) >= 0)){
+			break;
+		}
+		visit(node);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Visit the nodes with keys within a given range (key1 <= key2) by several threads.
+ * The range is cut into chunks at the nodes of an upper level, a few chunks per thread,
+ * and each thread visits the nodes of the next chunk left at level 0, so the visitor is called concurrently.
+ * The skiplist can't be modified meanwhile, except by the writer of a SWMR list,
+ * then the calling thread holds a SkiplistEpochGuard, which keeps the nodes for the other threads as well
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param visit
+ * 		called with each node, from several threads at the same time
+ * @param threads
+ * 		how many threads visit the nodes including the calling thread, 0 for std::thread::hardware_concurrency()
+ * 
+ * @return
+ * 		how many nodes are visited
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Visitor>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::parallelForEach(const KeyType& key1, const KeyType& key2, Visitor visit, int threads) const{
+	std::vector<struct skiplist_node_t<KeyType,ValueType>*> bounds;
+	std::atomic<int> count(0);
+
+	if(threads <= 0){
+		threads = (int)std::thread::hardware_concurrency();
+		threads = (threads > 0) ? threads : 1;
+	}
+
+	_parallelBounds(key1, key2, threads*SKIPLIST_PARALLEL_CHUNKS, &bounds);
+	if(bounds.empty()){
+		return 0;
+	}
+
+	_parallelRun((int)bounds.size()-1, threads, [&](int chunk){
+		count.fetch_add(_parallelChunk(bounds, chunk, key2, visit), std::memory_order_relaxed);
+	});
+
+	return count.load();
+}
+
+/*
+ * Reduce the nodes with keys within a given range (key1 <= key2) by several threads, see parallelForEach.
+ * Each chunk is reduced from init by one thread, then the results of the chunks are combined in the order of the keys,
+ * so combine has to be associative but not commutative
+ * 
+ * @param key1
+ * 		a given key1 served as the lower bound, included
+ * @param key2
+ * 		a given key2 served as the upper bound, included
+ * @param init
+ * 		the identity of combine, e.g. 0 for a sum
+ * @param reduce
+ * 		Result reduce(const Result& result, const struct skiplist_node_t<KeyType,ValueType>* node), adds a node to a result
+ * @param combine
+ * 		Result combine(const Result& result1, const Result& result2), combines the results of two chunks
+ * @param threads
+ * 		how many threads reduce the nodes including the calling thread, 0 for std::thread::hardware_concurrency()
+ * 
+ * @return
+ * 		the result, init if no node is in the range
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Result, class Reduce, class Combine>
+inline Result Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::parallelReduce(const KeyType& key1, const KeyType& key2, Result init, Reduce reduce, Combine combine, int threads) const{
+	std::vector<struct skiplist_node_t<KeyType,ValueType>*> bounds;
+
+	if(threads <= 0){
+		threads = (int)std::thread::hardware_concurrency();
+		threads = (threads > 0) ? threads : 1;
+	}
+
+	_parallelBounds(key1, key2, threads*SKIPLIST_PARALLEL_CHUNKS, &bounds);
+	if(bounds.empty()){
+		return init;
+	}
+
+	std::vector<Result> results(bounds.size()-1, init);
+	_parallelRun((int)results.size(), threads, [&](int chunk){
+		Result& result = results[chunk];
+		_parallelChunk(bounds, chunk, key2, [&](const struct skiplist_node_t<KeyType,ValueType>* node){
+			result = reduce(result, node);
+		});
+	});
+
+	for(size_t i = 1; i < results.size(); i++){
+		results[0] = combine(results[0], results[i]);
+	}
+
+	return results[0];
+}
+
+/*
+ * Move the stats of the nodes from a given node to the end of the list to another skiplist,
+ * only if SKIPLIST_ENABLE_STATS is defined
+ * 
+ * @param node
+ * 		the first node to move
+ * @param other
+ * 		the skiplist that the nodes move to
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_moveStats(struct skiplist_node_t<KeyType,ValueType>* node, Skiplist* other){
+	SKIPLIST_STAT(
+		for(; node != NULL; node = node->next[0]){
+			int level = ((node->level < SKIPLIST_STATS_LEVELS) ? node->level : SKIPLIST_STATS_LEVELS)-1;
+			size_t bytes = _nodeSize(node->level);
+
+			if(NULL == node->prev){
+				_stats.runs--;
+				other->_stats.runs++;
+				_stats.runLengths[_runBucket(node)]--;
+				other->_stats.runLengths[_runBucket(node)]++;
+				if(node->tail != &node->inlineTail){
+					bytes += _tailSize();
+				}
+			}
+			_stats.levels[level]--;
+			other->_stats.levels[level]++;
+			_stats.nodes--;
+			other->_stats.nodes++;
+			_stats.bytes -= bytes;
+			other->_stats.bytes += bytes;
+		}
+	);
+	(void)node;
+	(void)other;
 }
 
-/* 
- * Insert a node into the skiplist
+/*
+ * Move the nodes with keys equal or larger than a given key to an empty skiplist.
+ * Only the links into the moved nodes are cut, one at each level, and the nodes keep their addresses,
+ * so the pointers returned by insert stay valid and are passed to del of the other skiplist.
+ * The nodes with the same key move together with their shared tail.
+ * With SKIPLIST_ENABLE_RANK it's O(log(n)), otherwise counting the moved nodes walks level 0 of the smaller part.
+ * The allocators are merged, so either skiplist can release the nodes of the other afterwards
  * 
  * @param key
- * 		the key of the node
- * @param value
- * 		the value of the node
- * @param node
- * 		the address of a pointer points to the ndoe that will be allocated memory in this function, 
- * 		has to be NULL when calling this function
+ * 		a given key, the first key moved
+ * @param other
+ * 		an empty skiplist which receives the nodes, served as an output
  * 
- * @return 
- * 		return true if success
+ * @return
+ * 		return true if success, false if the other skiplist is not empty or the allocators can't be merged
  */
-template <class KeyType, class ValueType>
-inline bool Skiplist<KeyType, ValueType>::insert(KeyType key, ValueType value, struct skiplist_node_t<KeyType,ValueType>** node){
-	struct skiplist_node_t<KeyType,ValueType>* prevNodes[_maxLevel];
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::split(const KeyType& key, Skiplist* other){
+	struct skiplist_node_t<KeyType,ValueType>* prevNodes[SKIPLIST_MAX_LEVEL_LIMIT];
 	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+	int moved, level = 0;
+#ifdef SKIPLIST_ENABLE_RANK
+	int rankAt[SKIPLIST_MAX_LEVEL_LIMIT];	//the ranks of the prev nodes
+	int rank = 0;
+#endif
 
-	//the *node should be NULL
-	//otherwise it is inserted
-	if(*node != NULL){
-		std::cout<<"This node is already inserted"<<std::endl;
+	if(other == this || other->_count != 0){
+		std::cout<<"The other skiplist is not empty"<<std::endl;
 		return false;
 	}
 
-	//Search for the prev nodes at each level from the top level
-	for(int i = _curr_level; i >= 0; i--){
-		while( (existNode = cursor->next[i]) && _comp(existNode->key, key) < 0)
-            cursor = *(existNode->tail);	//Update the cursor to the tail, 
-											//as tail is either pointed to the existNode or the tail of the nodes with the same key
-		//If the key of existNode is equal or larger than the given key,
-		//the cursor is the prev node at that level
-        prevNodes[i] = cursor;
+	if(!_alloc.merge(other->_alloc)){
+		std::cout<<"The allocators of the skiplists can't be merged"<<std::endl;
+		return false;
 	}
 
-	//Key exists
-	if(existNode && _comp(existNode->key, key) == 0){
-		//the nodes with the same key have the same number of levels
-		*node = _createNode(key,value, existNode->level, existNode->tail);
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
 
-		//insert the new node before the existNode
-		existNode->prev = *node;
-	}else{
-		//compute the number of levels
-		int level = _randomLevel();
+	//the prev nodes at each level are the last nodes left in this skiplist
+	for(int i=_curr_level-1; i>=0; i--){
+		while( (existNode = cursor->next[i]) && _compare(existNode->key, key) < 0){
+			SKIPLIST_RANK(rank += _widths(cursor)[i] + _runSkip(existNode));
+			cursor = *existNode->tail;
+			_prefetch(cursor, i);
+			SKIPLIST_STAT(_statHop());
+		}
+		prevNodes[i] = cursor;
+		SKIPLIST_RANK(rankAt[i] = rank);
+	}
 
-		//if the level equals the current level,
-		//increase the current level
-		if(level == _curr_level){
-			_curr_level++;
+	if(NULL == existNode){
+		return true;
+	}
+
+#ifdef SKIPLIST_ENABLE_RANK
+	moved = _count - rank;
+#else
+	//walk from both ends of the cut until one of them ends
+	struct skiplist_node_t<KeyType,ValueType> *left = _sudoHead, *right = existNode;
+	for(moved = 0; ; moved++){
+		if(NULL == right){
+			break;
 		}
+		right = right->next[0];
 
-		//as level starts from 0
-		//pass level+1 to create a new node
-		*node = _createNode(key,value, level+1,NULL);
+		if(left->next[0] == existNode){
+			//moved counts the nodes before the cut here
+			moved = _count - moved;
+			break;
+		}
+		left = left->next[0];
 	}
+#endif
 
-	if(NULL == *node){
-		std::cout<<"create node fail in insert"<<std::endl;
-		return false;
+	SKIPLIST_RANK(
+		for(int i = 0; i < _curr_level; i++){
+			//the head of the other skiplist has rank 0, which is rank in this skiplist
+			if(prevNodes[i]->next[i]){
+				_widths(other->_sudoHead)[i] = rankAt[i] + _widths(prevNodes[i])[i] - rank;
+			}else{
+				_widths(other->_sudoHead)[i] = moved + 1;
+			}
+			_widths(prevNodes[i])[i] = rank + 1 - rankAt[i];
+		}
+	);
+
+	_moveStats(existNode, other);
+
+	//link the moved nodes to the other head before they are cut from this skiplist
+	for(int i = 0; i < _curr_level; i++){
+		Sync::store(&other->_sudoHead->next[i], prevNodes[i]->next[i]);
 	}
+	if(other->_maxLevel < _maxLevel){
+		other->_maxLevel = _maxLevel;
+	}
+	Sync::store(&other->_curr_level, _curr_level);
+	Sync::store(&other->_count, moved);
 
-	//Insert the node after the prev nodes at each level,
-	//starts from the top level
-	for(int i = (*node)->level-1; i >= 0; i--){
-		(*node)->next[i] = prevNodes[i]->next[i];
-		prevNodes[i]->next[i] = *node;
+	for(int i = _curr_level-1; i >= 0; i--){
+		Sync::store(&prevNodes[i]->next[i], (struct skiplist_node_t<KeyType,ValueType>*)NULL);
+		if(0 == level && _sudoHead->next[i]){
+			level = i+1;
+		}
 	}
+	Sync::store(&_curr_level, level);
+	Sync::store(&_count, _count - moved);
 
-	_count++;
+	//the levels of the other skiplist without any node
+	for(level = other->_curr_level; level > 0 && NULL == other->_sudoHead->next[level-1]; level--);
+	Sync::store(&other->_curr_level, level);
 
 	return true;
 }
 
 /*
- * Remove a given node from the list
+ * Append the nodes of another skiplist, whose keys are all larger than the keys of this skiplist.
+ * The last link at each level is linked to the first node of the other skiplist at that level, so it's O(log(n)).
+ * The nodes keep their addresses and the other skiplist becomes empty.
+ * The allocators are merged, so either skiplist can release the nodes of the other afterwards
  * 
- * @param node
- * 		an address of a pointer points to the node that needs to be removed
+ * @param other
+ * 		the skiplist to be appended
  * 
  * @return
- * 		return true if success
+ * 		return true if success, false if a key of the other skiplist is not larger than all keys of this skiplist,
+ * 		or the allocators can't be merged
  */
-template <class KeyType, class ValueType>
-inline bool Skiplist<KeyType, ValueType>::del(struct skiplist_node_t<KeyType,ValueType>** node){
-    //If the *node is NULL, means it's not inserted
-	if(NULL == *node){
-		std::cout<<"This node is not inserted"<<std::endl;
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::join(Skiplist* other){
+	struct skiplist_node_t<KeyType,ValueType>* lastNodes[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType> *existNode, *cursor=_sudoHead;
+	int level = (_curr_level > other->_curr_level) ? _curr_level : other->_curr_level;
+#ifdef SKIPLIST_ENABLE_RANK
+	int rankAt[SKIPLIST_MAX_LEVEL_LIMIT];	//the ranks of the last nodes
+	int rank = 0;
+#endif
+
+	if(other == this){
+		std::cout<<"A skiplist can't be joined with itself"<<std::endl;
 		return false;
 	}
 
-	if((*node)->prev != NULL){
-		//this node is not the head of a list of nodes which have the same key
-
-		if(*(*node)->tail == *node){
-			//if this node is the tail of a list of nodes which have the same key
-			//change the tail pointer of all nodes in this list
-			*(*node)->prev->tail = (*node)->prev;
-		}else{
-			//otherwise this node is one in the middle
-			//rearrange the prev pointer
-			(*node)->next[0]->prev = (*node)->prev;
-		}
+	if(0 == other->_count){
+		return true;
+	}
 
-		//update the next pointers of the prev nodes from the top level
-		for(int i = (*node)->level-1; i >= 0; i--){
-			(*node)->prev->next[i] = (*node)->next[i];	
+	//the last nodes at each level
+	for(int i=level-1; i>=0; i--){
+		while( (existNode = cursor->next[i]) ){
+			SKIPLIST_RANK(rank += _widths(cursor)[i] + _runSkip(existNode));
+			cursor = *existNode->tail;
+			_prefetch(cursor, i);
 		}
-	}else{
-		//this node is the head of a list of nodes which have the same key
-		//or the key of this node is unique in the skiplist
-		struct skiplist_node_t<KeyType,ValueType>* prevNodes[_maxLevel];
-		struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
+		lastNodes[i] = cursor;
+		SKIPLIST_RANK(rankAt[i] = rank);
+	}
 
-		//search for the prev nodes at each level
-		for(int i = _curr_level; i >= 0; i--){
-			while( (existNode = cursor->next[i]) && _comp(existNode->key, (*node)->key) < 0)
-           		cursor = *(existNode->tail);
+	if(cursor != _sudoHead && _compare(other->_sudoHead->next[0]->key, cursor->key) <= 0){
+		std::cout<<"The keys of the other skiplist are not larger"<<std::endl;
+		return false;
+	}
 
-        	prevNodes[i] = cursor;
-		}
+	if(!_alloc.merge(other->_alloc)){
+		std::cout<<"The allocators of the skiplists can't be merged"<<std::endl;
+		return false;
+	}
 
-		//if the found node is not the node that we want to remove, something went wrong
-		if(existNode != *node){
-			std::cout<<"list error"<<std::endl;
-			return false;
+	SKIPLIST_RANK(
+		for(int i = 0; i < level; i++){
+			if(other->_sudoHead->next[i]){
+				_widths(lastNodes[i])[i] = _widths(other->_sudoHead)[i] + _count - rankAt[i];
+			}else{
+				_widths(lastNodes[i])[i] = _count + other->_count + 1 - rankAt[i];
+			}
 		}
+	);
 
-		if((*node)->next[0]){
-			//update the prev pointer of the following node to NULL
-			//as the next[0] can only be a head of a list of nodes which have the same key
-			//or the key of next[0] is unique in the skiplist
-			(*node)->next[0]->prev = NULL;	
-		}
-			
-		//update the next pointers of the prev nodes from the top level
-		for(int i = _curr_level-1; i >= 0; i--)
-    	{
-			if(prevNodes[i]->next[i] == *node)
-			{
-				prevNodes[i]->next[i] = (*node)->next[i];
-				
-				//if the removed node is the last one at a level, lower down the current level
-				if(_sudoHead->next[i]==NULL)
-					_curr_level--;
-			}
-    	}
+	other->_moveStats(other->_sudoHead->next[0], this);
 
-		//as this node is the only one has the key in the skiplist,
-		//free the tail
-		free((*node)->tail);
+	for(int i = level-1; i >= 0; i--){
+		Sync::store(&lastNodes[i]->next[i], other->_sudoHead->next[i]);
 	}
+	if(_maxLevel < other->_maxLevel){
+		_maxLevel = other->_maxLevel;
+	}
+	Sync::store(&_curr_level, level);
+	Sync::store(&_count, _count + other->_count);
+	_grow(_count);
 
-	_count--;
-	free(*node);
-	//point the *node to NULL, so we can reinsert
-	*node = NULL;
+	for(int i = 0; i < other->_curr_level; i++){
+		Sync::store(&other->_sudoHead->next[i], (struct skiplist_node_t<KeyType,ValueType>*)NULL);
+	}
+	Sync::store(&other->_curr_level, 0);
+	Sync::store(&other->_count, 0);
 
 	return true;
 }
 
+#ifdef SKIPLIST_ENABLE_RANK
 /*
- * Search for nodes with a given key
- * There might be multiple nodes with the same key
- * If nodes with the key exist, the *start and *end are not NULL. 
- * User don't need to check whether they are NULL if the marco: list_each_sl_node is called to loop through the output
+ * Count the nodes with keys smaller than a given key, or equal or smaller if equal is true,
+ * by adding up the widths of the links a search goes through
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+template <class Key>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::_rank(const Key& key, bool equal) const{
+	struct skiplist_node_t<KeyType,ValueType> *existNode, *cursor=_sudoHead;
+	int rank = 0;
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_SEARCH, 1));
+
+	for(int i=_curr_level-1; i>=0; i--){
+		while( (existNode = cursor->next[i]) && _compare(existNode->key, key) < (equal ? 1 : 0)){
+			rank += _widths(cursor)[i] + _runSkip(existNode);
+			cursor = *existNode->tail;
+			SKIPLIST_STAT(_statHop());
+		}
+	}
+
+	return rank;
+}
+
+/*
+ * Get the rank of a key, i.e. how many nodes have a smaller key,
+ * which is also the index of the first node with the key if it exists
  * 
  * @param key
  * 		a given key
- * @param start
- * 		An address of a pointer points to the start of a list of nodes with the given key, served as an output
- * @param end 
- * 		An address of a pointer points to the tail of a list of nodes with the given key, served as an output
  * 
- * @return 
- * 		if nodes with the given key exist, return true and the *start and *end are not NULL,
- * 		otherwise return false, and the *start == *end == NULL
+ * @return
+ * 		the rank, from 0 to getNodesNum()
  */
-template <class KeyType, class ValueType>
-inline bool Skiplist<KeyType, ValueType>::search(KeyType key, struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
-	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
-	//set the *start and *end to NULL
-	*start = *end = NULL;
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::rank(const KeyType& key) const{
+	return _rank(key, false);
+}
 
-	//Search for nodes have the given key from the top
+/*
+ * Get the node at a given index in the order of the keys.
+ * The links are followed as long as they don't go past the index,
+ * so it's O(log(n)) plus the nodes before it with the same key
+ * 
+ * @param index
+ * 		the index, from 0 to getNodesNum()-1
+ * 
+ * @return
+ * 		the node, NULL if the index is out of range
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline struct skiplist_node_t<KeyType,ValueType>* Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::select(int index) const{
+	struct skiplist_node_t<KeyType,ValueType> *existNode, *cursor=_sudoHead;
+	int rank = 0;
+
+	if(index < 0 || index >= _count){
+		return NULL;
+	}
+
+	//the node at the index has rank index+1, as the head has rank 0
 	for(int i=_curr_level-1; i>=0; i--){
-		while( (existNode = cursor->next[i]) && _comp(existNode->key, key) < 0)
-            cursor = *(existNode->tail);
+		while( (existNode = cursor->next[i]) && rank + _widths(cursor)[i] <= index + 1){
+			rank += _widths(cursor)[i];
+			cursor = existNode;
 
-		//stop if found
-        if(existNode && _comp(existNode->key, key) == 0){
-			*start = existNode;
-			*end = *existNode->tail;
-			return true;
+			//skip the nodes with the same key if the index is after them
+			if(NULL == existNode->prev && rank + _runSkip(existNode) <= index + 1){
+				rank += _runSkip(existNode);
+				cursor = *existNode->tail;
+			}
+		}
+
+		if(rank == index + 1){
+			return cursor;
 		}
 	}
 
-	return false;
+	return NULL;
 }
 
 /*
- * Search for nodes with keys within a given range (key1 <= key2)
- * It can be a rough range, i.e. the key1 and key2 don't need to be in the skiplist
- * There might be multiple nodes with the same key
- * If there are nodes within the given range, the *start and *end are not NULL
- * User don't need to check whether they are NULL if the marco: list_each_sl_node is called to loop through the output
+ * Count the nodes with keys within a given range (key1 <= key2), the same nodes search(key1, key2) finds
  * 
  * @param key1
- * 		a given key1 served as the lower bound
+ * 		a given key1 served as the lower bound, included
  * @param key2
- * 		a given key1 served as the upper bound
- * @param start
- * 		An address of a pointer points to the start of a list of nodes with the given key, served as an output
- * @param end 
- * 		An address of a pointer points to the tail of a list of nodes with the given key, served as an output
+ * 		a given key2 served as the upper bound, included
  * 
- * @return 
- * 		if nodes with the given key exist, return true and the *start and *end are not NULL,
- * 		otherwise return false, and the *start == *end == NULL
+ * @return
+ * 		how many nodes, 0 if key1 is larger than key2
  */
-template <class KeyType, class ValueType>
-inline bool Skiplist<KeyType, ValueType>::search(KeyType key1, KeyType key2,struct skiplist_node_t<KeyType,ValueType>** start, struct skiplist_node_t<KeyType,ValueType>** end){
-	//downgrade to normal search
-	if(key1 == key2)
-		return search(key1, start, end);
-	
-	if(key1 > key2){
-		std::cout<<"key1: "<<key1<<" is larger than key2: "<<key2<<std::endl;
-		return false;
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::countRange(const KeyType& key1, const KeyType& key2) const{
+	if(_compare(key1, key2) > 0){
+		return 0;
 	}
-	
-	struct skiplist_node_t<KeyType,ValueType> *existNode=NULL, *cursor=_sudoHead;
-	struct skiplist_node_t<KeyType,ValueType>* prevNodes[_maxLevel];
-	//set the *start and *end to NULL
-	*start = *end = NULL;
 
-	//search for the node that has key equals to the key1 or just larger than key1
-	for(int i=_curr_level-1; i>=0; i--){
-		while( (existNode = cursor->next[i]) && _comp(existNode->key, key1) < 0)
-            cursor = *(existNode->tail);
+	return _rank(key2, true) - _rank(key1, false);
+}
+#endif
 
-		//if key1 exists, stop the search
-        if(existNode && _comp(existNode->key, key1) == 0){
-			break;
+/*
+ * Write a snapshot of the skiplist to a stream, through a fixed size buffer.
+ * The keys and values are written as raw bytes, so both have to be trivially copyable,
+ * except that integer keys are written as the differences from the previous keys
+ * 
+ * @param out
+ * 		the stream, opened in binary mode
+ * 
+ * @return 
+ * 		return true if success
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::save(std::ostream& out) const{
+	static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+		"keys and values have to be trivially copyable to be saved");
+	struct skiplist_snapshot_header_t header = {SKIPLIST_SNAPSHOT_MAGIC, SKIPLIST_SNAPSHOT_VERSION,
+		(std::is_integral<KeyType>::value ? SKIPLIST_SNAPSHOT_DELTA_KEYS : 0) | SKIPLIST_SNAPSHOT_BYTE_ORDER,
+		sizeof(KeyType), sizeof(ValueType), (uint64_t)_count};
+	struct skiplist_node_t<KeyType,ValueType> *node, *last;
+	SkiplistSnapshotWriter* writer = new SkiplistSnapshotWriter(out);
+	bool success;
+
+	writer->write(&header, sizeof(header));
+
+	//each list of nodes with the same key is written as one key, the number of nodes and their values
+	for(node = _sudoHead->next[0]; node != NULL; node = last->next[0]){
+		uint64_t num = 1;
+
+		last = _tail(node);
+		for(struct skiplist_node_t<KeyType,ValueType>* cursor = node; cursor != last; cursor = cursor->next[0])
+			num++;
+
+		writer->writeKey(node->key);
+		writer->writeVarint(num);
+		for(struct skiplist_node_t<KeyType,ValueType>* cursor = node; ; cursor = cursor->next[0]){
+			writer->write(&cursor->value, sizeof(ValueType));
+			if(cursor == last){
+				break;
+			}
 		}
 	}
 
-	//there are two situations:
-	//1. existNode has the key1
-	//2. the key1 doesn't exist, so the existNode is the one with a key that is just larger than the given key1
-	*start = existNode;
+	success = writer->flush();
+	delete writer;
 
-	//reset the two pointers
-	existNode=NULL;
-	cursor=_sudoHead;
+	return success;
+}
 
-	//search for the node with a key that is just larger than the key2
-	for(int i=_curr_level-1; i>=0; i--){
-		while( (existNode = cursor->next[i]) && _comp(existNode->key, key2) < 0)
-            cursor = *(existNode->tail);
-		
-		//if key2 exists, stop search and set *end to the existNode
-        if(existNode && _comp(existNode->key, key2) == 0){
-			*end = existNode;
-			break;
-		}
-		
-		//update the prev nodes at each level
-		prevNodes[i] = cursor;
+/*
+ * Load a snapshot written by save into an empty skiplist.
+ * The nodes are appended in one pass with the same levels as bulkLoad, without searching
+ * 
+ * @param in
+ * 		the stream, opened in binary mode
+ * 
+ * @return 
+ * 		return true if success. If the snapshot is broken, return false and
+ * 		the nodes before the broken part stay in the skiplist
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::load(std::istream& in){
+	static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+		"keys and values have to be trivially copyable to be loaded");
+	struct skiplist_node_t<KeyType,ValueType>* last[SKIPLIST_MAX_LEVEL_LIMIT];
+	struct skiplist_node_t<KeyType,ValueType>* node;
+	struct skiplist_snapshot_header_t header;
+	SkiplistSnapshotReader* reader;
+	uint64_t loaded = 0;
+	int distinct = 0;
+	bool success = true;
+
+	if(_count != 0){
+		std::cout<<"The skiplist is not empty"<<std::endl;
+		return false;
 	}
 
-	//if key2 doesn't exist, set *end to the prev node at level 0, whose key2 is just smaller than the key2
-	if(NULL == *end){
-		*end = prevNodes[0];
+	reader = new SkiplistSnapshotReader(in);
+	if(!reader->read(&header, sizeof(header))){
+		std::cout<<"not a snapshot of this type of skiplist"<<std::endl;
+		delete reader;
+		return false;
 	}
 
-	if(*start != NULL && *end != NULL){
-		return true;
-	}else{
+	//the magic is swapped in a snapshot of the other byte order
+	if(header.magic == __builtin_bswap64(SKIPLIST_SNAPSHOT_MAGIC) ||
+	   (header.magic == SKIPLIST_SNAPSHOT_MAGIC && (header.flags & SKIPLIST_SNAPSHOT_BIG_ENDIAN) != SKIPLIST_SNAPSHOT_BYTE_ORDER)){
+		std::cout<<"the snapshot is of the other byte order"<<std::endl;
+		delete reader;
 		return false;
 	}
+
+	if(header.magic != SKIPLIST_SNAPSHOT_MAGIC || header.version != SKIPLIST_SNAPSHOT_VERSION ||
+	   header.keySize != sizeof(KeyType) || header.valueSize != sizeof(ValueType) ||
+	   header.flags != ((std::is_integral<KeyType>::value ? SKIPLIST_SNAPSHOT_DELTA_KEYS : 0u) | SKIPLIST_SNAPSHOT_BYTE_ORDER)){
+		std::cout<<"not a snapshot of this type of skiplist"<<std::endl;
+		delete reader;
+		return false;
+	}
+
+	_grow(header.count);
+	_bulkStart(last);
+
+	SKIPLIST_STAT(_statCall(SKIPLIST_STAT_INSERT, header.count));
+
+	while(success && loaded < header.count){
+		KeyType key;
+		ValueType value;
+		uint64_t num;
+
+		success = reader->readKey(&key) && reader->readVarint(&num) && num > 0 && num <= header.count - loaded;
+		for(; success && num > 0; num--, loaded++){
+			success = reader->read(&value, sizeof(ValueType)) && _bulkAppend(key, value, last, &distinct, &node);
+		}
+	}
+	_bulkFinish(last);
+
+	if(!success){
+		std::cout<<"the snapshot is broken"<<std::endl;
+	}
+	delete reader;
+
+	return success;
 }
 
 /*
@@ -510,9 +3203,9 @@ inline bool Skiplist<KeyType, ValueType>::search(KeyType key1, KeyType key2,stru
  * @return 
  * 		the current number of levels
  */
-template <class KeyType, class ValueType>
-inline int Skiplist<KeyType, ValueType>::getCurrentLevel(){
-    return this->_curr_level;
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::getCurrentLevel(){
+    return Sync::load(&this->_curr_level);
 }
 
 /*
@@ -521,16 +3214,108 @@ inline int Skiplist<KeyType, ValueType>::getCurrentLevel(){
  * @return 
  * 		the number of nodes
  */
-template <class KeyType, class ValueType>
-inline int Skiplist<KeyType, ValueType>::getNodesNum(){
-    return this->_count;
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline int Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::getNodesNum(){
+    return Sync::load(&this->_count);
+}
+
+/*
+ * Get a snapshot of the stats, which are only collected if SKIPLIST_ENABLE_STATS is defined.
+ * The operations of all threads are added up. The levels, nodes, runs and bytes are changed by the writer,
+ * so it's called by the writer, or when no thread writes the list
+ * 
+ * @param stats
+ * 		the snapshot, served as an output
+ * 
+ * @return 
+ * 		return true if the stats are collected
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline bool Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::getStats(struct skiplist_stats_t* stats) const{
+#ifdef SKIPLIST_ENABLE_STATS
+	std::lock_guard<std::mutex> lock(_countersLock);
+
+	*stats = _stats;
+	for(size_t i = 0; i < _counters.size(); i++){
+		for(int j = 0; j < SKIPLIST_STAT_OPS; j++){
+			stats->calls[j] += _counters[i]->calls[j].load(std::memory_order_relaxed);
+			stats->hops[j] += _counters[i]->hops[j].load(std::memory_order_relaxed);
+			stats->compares[j] += _counters[i]->compares[j].load(std::memory_order_relaxed);
+		}
+	}
+	return true;
+#else
+	(void)stats;
+	return false;
+#endif
+}
+
+/*
+ * Reset the counters of the operations, i.e. calls, hops and compares
+ * The level histogram, nodes, runs and bytes describe the current list and are kept
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::resetStats(){
+	SKIPLIST_STAT(
+		std::lock_guard<std::mutex> lock(_countersLock);
+		for(size_t i = 0; i < _counters.size(); i++){
+			for(int j = 0; j < SKIPLIST_STAT_OPS; j++){
+				_counters[i]->calls[j].store(0, std::memory_order_relaxed);
+				_counters[i]->hops[j].store(0, std::memory_order_relaxed);
+				_counters[i]->compares[j].store(0, std::memory_order_relaxed);
+			}
+		}
+	);
+}
+
+/*
+ * Print the stats: the hops and compares per operation,
+ * the level histogram against the expected distribution, the run lengths of the duplicates and the memory
+ */
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::printStats(){
+	struct skiplist_stats_t stats;
+	static const char* names[SKIPLIST_STAT_OPS] = {"insert", "search", "del"};
+
+	if(!getStats(&stats)){
+		std::cout<<"Stats are not collected, define SKIPLIST_ENABLE_STATS to collect them"<<std::endl;
+		return;
+	}
+
+	for(int i = 0; i < SKIPLIST_STAT_OPS; i++){
+		double calls = stats.calls[i] ? (double)stats.calls[i] : 1.0;
+		std::cout<<names[i]<<": "<<stats.calls[i]<<" calls, "<<stats.hops[i]/calls<<" hops and "
+				 <<stats.compares[i]/calls<<" compares per call"<<std::endl;
+	}
+
+	//a node has n levels with the probability of (1-p) * p^(n-1), p = 1/2^SKIPLIST_LEVEL_SHIFT
+	double expected = stats.nodes * (1.0 - 1.0/(1 << SKIPLIST_LEVEL_SHIFT));
+	for(int i = 0; i < SKIPLIST_STATS_LEVELS && (stats.levels[i] || expected >= 1.0); i++, expected /= (1 << SKIPLIST_LEVEL_SHIFT)){
+		std::cout<<"level "<<i<<": "<<stats.levels[i]<<" nodes, expected "<<expected<<std::endl;
+	}
+
+	std::cout<<stats.nodes<<" nodes, "<<stats.runs<<" distinct keys, "
+			 <<(stats.runs ? (double)stats.nodes/stats.runs : 0.0)<<" nodes per key"<<std::endl;
+	for(int i = 0; i < SKIPLIST_STATS_RUNS; i++){
+		if(0 == stats.runLengths[i]){
+			continue;
+		}
+		std::cout<<"keys with "<<(1 << i);
+		if(i == SKIPLIST_STATS_RUNS-1){
+			std::cout<<" or more";
+		}else if(i > 0){
+			std::cout<<" to "<<(1 << (i+1)) - 1;
+		}
+		std::cout<<" nodes: "<<stats.runLengths[i]<<std::endl;
+	}
+	std::cout<<stats.bytes<<" bytes, "<<(stats.nodes ? (double)stats.bytes/stats.nodes : 0.0)<<" bytes per node"<<std::endl;
 }
 
 /*
  * Print the nodes at each level, start from the current top level to level 0
  */
-template <class KeyType, class ValueType>
-inline void Skiplist<KeyType, ValueType>::printList(){
+template <class KeyType, class ValueType, class Compare, class Allocator, class Sync>
+inline void Skiplist<KeyType, ValueType, Compare, Allocator, Sync>::printList(){
 	struct skiplist_node_t<KeyType,ValueType>* node;
     
 	std::cout<<"Skiplist has "<<_count<<" nodes."<<std::endl;
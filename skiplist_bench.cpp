@@ -0,0 +1,460 @@
+/*
+  skiplist_bench.cpp - benchmark of Skiplist, PackedSkiplist, std::map and std::multimap.
+
+  Workloads: Insert, Delete, point Search and RangeSearch,
+  under uniform, Zipfian, sorted, reverse sorted and duplicate heavy keys,
+  at 1e3, 1e4, ... keys up to SKIPLIST_BENCH_MAX_N (environment variable, 1e6 by default, up to 1e8).
+
+  Besides the time and items_per_second reported by Google Benchmark,
+  every benchmark reports the p50/p99 latency in ns of 1 in 16 operations,
+  and Insert reports the heap bytes per entry.
+
+  Usage:
+  	./skiplist_bench --benchmark_filter=Search/Skiplist/Zipfian
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <benchmark/benchmark.h>
+#include "skiplist.h"
+#include "packed_skiplist.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#define BENCH_DEFAULT_MAX_N 1000000
+#define BENCH_PROBES (1 << 20)				//number of keys searched in a round, a power of 2
+#define BENCH_MAX_SAMPLES (1 << 22)			//max latency samples kept by a benchmark
+#define BENCH_SAMPLE_MASK 15				//1 in 16 operations is timed
+#define BENCH_RANGE_ENTRIES 100				//about how many entries a range search covers
+#define BENCH_DUPLICATES 64					//how many times each key appears in the duplicate heavy workload
+#define BENCH_MAX_LEVEL 16					//enough for 1e8 keys with the 1/4 probability of levels
+
+enum bench_dist_t{
+	BENCH_UNIFORM,
+	BENCH_ZIPFIAN,
+	BENCH_SORTED,
+	BENCH_REVERSE,
+	BENCH_DUPLICATES_HEAVY,
+	BENCH_DIST_NUM
+};
+
+static const char* benchDistNames[BENCH_DIST_NUM] = {"Uniform", "Zipfian", "Sorted", "Reverse", "Duplicates"};
+
+/*
+ * Zipfian ranks from 0 to n-1, rank 0 is the most popular, as the generator of YCSB
+ */
+class ZipfianGenerator{
+    private:
+		double _n, _theta, _alpha, _zetan, _eta;
+
+    public:
+		ZipfianGenerator(uint64_t n, double theta = 0.99): _n((double)n), _theta(theta){
+			double zeta2 = 1.0 + std::pow(0.5, theta);
+
+			_zetan = 0;
+			for(uint64_t i = 1; i <= n; i++){
+				_zetan += 1.0 / std::pow((double)i, theta);
+			}
+			_alpha = 1.0 / (1.0 - theta);
+			_eta = (1.0 - std::pow(2.0 / _n, 1.0 - theta)) / (1.0 - zeta2 / _zetan);
+		}
+
+		template <class Random>
+		uint64_t next(Random& rand){
+			double u = std::uniform_real_distribution<double>(0.0, 1.0)(rand);
+			double uz = u * _zetan;
+
+			if(uz < 1.0){
+				return 0;
+			}
+			if(uz < 1.0 + std::pow(0.5, _theta)){
+				return 1;
+			}
+
+			uint64_t rank = (uint64_t)(_n * std::pow(_eta*u - _eta + 1.0, _alpha));
+			return (rank < (uint64_t)_n) ? rank : (uint64_t)_n - 1;
+		}
+};
+
+//spread ranks over the key space, so popular keys aren't next to each other
+static long benchScramble(uint64_t x){
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return (long)((x ^ (x >> 31)) >> 2);
+}
+
+/*
+ * Generate the keys to insert, in the order of insertion
+ */
+static std::vector<long> benchMakeKeys(int dist, size_t n){
+	std::vector<long> keys(n);
+	std::mt19937_64 rand(n);
+
+	switch(dist){
+		case BENCH_UNIFORM:
+			for(size_t i = 0; i < n; i++)
+				keys[i] = (long)(rand() >> 2);
+			break;
+		case BENCH_ZIPFIAN:{
+			ZipfianGenerator zipf(n);
+			for(size_t i = 0; i < n; i++)
+				keys[i] = benchScramble(zipf.next(rand));
+			break;
+		}
+		case BENCH_SORTED:
+			for(size_t i = 0; i < n; i++)
+				keys[i] = (long)i * 16;
+			break;
+		case BENCH_REVERSE:
+			for(size_t i = 0; i < n; i++)
+				keys[i] = (long)(n - i) * 16;
+			break;
+		case BENCH_DUPLICATES_HEAVY:{
+			uint64_t distinct = (n + BENCH_DUPLICATES - 1) / BENCH_DUPLICATES;
+			for(size_t i = 0; i < n; i++)
+				keys[i] = benchScramble(rand() % distinct);
+			break;
+		}
+	}
+
+	return keys;
+}
+
+/*
+ * Generate the keys to search, Zipfian searches are skewed towards the popular keys,
+ * the others are picked uniformly from the inserted keys
+ */
+static std::vector<long> benchMakeProbes(int dist, const std::vector<long>& keys){
+	std::vector<long> probes(BENCH_PROBES);
+	std::mt19937_64 rand(keys.size() + 1);
+
+	if(dist == BENCH_ZIPFIAN){
+		ZipfianGenerator zipf(keys.size());
+		for(size_t i = 0; i < probes.size(); i++)
+			probes[i] = benchScramble(zipf.next(rand));
+	}else{
+		for(size_t i = 0; i < probes.size(); i++)
+			probes[i] = keys[rand() % keys.size()];
+	}
+
+	return probes;
+}
+
+/*
+ * Heap bytes in use, 0 if unknown
+ */
+static size_t benchHeapBytes(){
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Times 1 in 16 operations and reports the percentiles
+ */
+class LatencySampler{
+    private:
+		std::vector<uint32_t> _samples;
+
+    public:
+		template <class Func>
+		void run(size_t i, Func func){
+			if((i & BENCH_SAMPLE_MASK) != 0 || _samples.size() >= BENCH_MAX_SAMPLES){
+				func();
+				return;
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			func();
+			std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+			_samples.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+		}
+
+		void report(benchmark::State& state){
+			if(_samples.empty()){
+				return;
+			}
+
+			size_t p50 = _samples.size() / 2, p99 = _samples.size() * 99 / 100;
+			std::nth_element(_samples.begin(), _samples.begin() + p50, _samples.end());
+			state.counters["p50_ns"] = _samples[p50];
+			std::nth_element(_samples.begin(), _samples.begin() + p99, _samples.end());
+			state.counters["p99_ns"] = _samples[p99];
+		}
+};
+
+/*
+ * Containers under test, all of them provide
+ * 		void insert(long key);
+ * 		bool erase(long key);		//erase one entry of the key
+ * 		bool find(long key);
+ * 		long range(long key1, long key2);	//count the entries from key1 to key2
+ * 		size_t size();
+ */
+class SkiplistContainer{
+    private:
+		typedef struct skiplist_node_t<long,long> node_t;
+		Skiplist<long,long> _list;
+
+    public:
+		SkiplistContainer(): _list(BENCH_MAX_LEVEL, SkiplistDefaultComp<long>()){}
+
+		void insert(long key){
+			node_t* node = NULL;
+			_list.insert(key, key, &node);
+		}
+
+		bool erase(long key){
+			node_t *start, *end;
+			return _list.search(key, &start, &end) && _list.del(&start);
+		}
+
+		bool find(long key){
+			node_t *start, *end;
+			return _list.search(key, &start, &end);
+		}
+
+		long range(long key1, long key2){
+			node_t *start, *end;
+			long count = 1;
+
+			if(!_list.search(key1, key2, &start, &end)){
+				return 0;
+			}
+			for(; start != end; start = start->next[0])
+				count++;
+
+			return count;
+		}
+
+		size_t size(){
+			return _list.getNodesNum();
+		}
+};
+
+class PackedSkiplistContainer{
+    private:
+		PackedSkiplist<long,long> _list;
+
+    public:
+		PackedSkiplistContainer(): _list(BENCH_MAX_LEVEL){}
+
+		void insert(long key){
+			_list.insert(key, key);
+		}
+
+		bool erase(long key){
+			return _list.erase(key);
+		}
+
+		bool find(long key){
+			return _list.find(key) != _list.end();
+		}
+
+		long range(long key1, long key2){
+			long count = 0;
+
+			for(PackedSkiplist<long,long>::iterator it = _list.lower_bound(key1); it != _list.end() && it.key() <= key2; ++it)
+				count++;
+
+			return count;
+		}
+
+		size_t size(){
+			return _list.getKeysNum();
+		}
+};
+
+template <class Map>
+class StdMapContainer{
+    private:
+		Map _map;
+
+    public:
+		void insert(long key){
+			_map.insert(typename Map::value_type(key, key));
+		}
+
+		bool erase(long key){
+			typename Map::iterator it = _map.find(key);
+
+			if(it == _map.end()){
+				return false;
+			}
+			_map.erase(it);
+
+			return true;
+		}
+
+		bool find(long key){
+			return _map.find(key) != _map.end();
+		}
+
+		long range(long key1, long key2){
+			long count = 0;
+
+			for(typename Map::iterator it = _map.lower_bound(key1); it != _map.end() && it->first <= key2; ++it)
+				count++;
+
+			return count;
+		}
+
+		size_t size(){
+			return _map.size();
+		}
+};
+
+template <class Container>
+static void benchInsert(benchmark::State& state, int dist){
+	size_t n = state.range(0);
+	std::vector<long> keys = benchMakeKeys(dist, n);
+	LatencySampler latency;
+	double bytes = 0;
+
+	for(auto _ : state){
+		state.PauseTiming();
+		Container* container = new Container();
+		size_t heap = benchHeapBytes();
+		state.ResumeTiming();
+
+		for(size_t i = 0; i < n; i++)
+			latency.run(i, [&]{ container->insert(keys[i]); });
+
+		state.PauseTiming();
+		bytes = (double)(benchHeapBytes() - heap) / container->size();
+		delete container;
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * n);
+	state.counters["bytes_per_entry"] = bytes;
+	latency.report(state);
+}
+
+template <class Container>
+static void benchDelete(benchmark::State& state, int dist){
+	size_t n = state.range(0);
+	std::vector<long> keys = benchMakeKeys(dist, n);
+	std::vector<long> order(keys);
+	LatencySampler latency;
+
+	std::shuffle(order.begin(), order.end(), std::mt19937_64(n));
+
+	for(auto _ : state){
+		state.PauseTiming();
+		Container* container = new Container();
+		for(size_t i = 0; i < n; i++)
+			container->insert(keys[i]);
+		state.ResumeTiming();
+
+		for(size_t i = 0; i < n; i++)
+			latency.run(i, [&]{ benchmark::DoNotOptimize(container->erase(order[i])); });
+
+		state.PauseTiming();
+		delete container;
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * n);
+	latency.report(state);
+}
+
+template <class Container>
+static void benchSearch(benchmark::State& state, int dist){
+	size_t n = state.range(0);
+	std::vector<long> keys = benchMakeKeys(dist, n);
+	std::vector<long> probes = benchMakeProbes(dist, keys);
+	std::unique_ptr<Container> container(new Container());
+	LatencySampler latency;
+	size_t i = 0;
+
+	for(size_t j = 0; j < n; j++)
+		container->insert(keys[j]);
+
+	for(auto _ : state){
+		long key = probes[i & (BENCH_PROBES - 1)];
+		latency.run(i++, [&]{ benchmark::DoNotOptimize(container->find(key)); });
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	latency.report(state);
+}
+
+template <class Container>
+static void benchRangeSearch(benchmark::State& state, int dist){
+	size_t n = state.range(0);
+	std::vector<long> keys = benchMakeKeys(dist, n);
+	std::vector<long> probes = benchMakeProbes(dist, keys);
+	std::unique_ptr<Container> container(new Container());
+	LatencySampler latency;
+	long width, entries = 0;
+	size_t i = 0;
+
+	for(size_t j = 0; j < n; j++)
+		container->insert(keys[j]);
+
+	//a range covers about BENCH_RANGE_ENTRIES entries on average
+	std::pair<std::vector<long>::iterator, std::vector<long>::iterator> bounds = std::minmax_element(keys.begin(), keys.end());
+	width = (long)((double)(*bounds.second - *bounds.first) / n * BENCH_RANGE_ENTRIES);
+
+	for(auto _ : state){
+		long key = probes[i & (BENCH_PROBES - 1)];
+		latency.run(i++, [&]{ entries += container->range(key, key + width); });
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["entries_per_range"] = benchmark::Counter((double)entries, benchmark::Counter::kAvgIterations);
+	latency.report(state);
+}
+
+template <class Container>
+static void benchRegister(const std::string& name, size_t maxN){
+	for(int dist = 0; dist < BENCH_DIST_NUM; dist++){
+		std::string suffix = "/" + name + "/" + benchDistNames[dist];
+
+		benchmark::internal::Benchmark* benches[] = {
+			benchmark::RegisterBenchmark(("Insert" + suffix).c_str(), benchInsert<Container>, dist),
+			benchmark::RegisterBenchmark(("Delete" + suffix).c_str(), benchDelete<Container>, dist),
+			benchmark::RegisterBenchmark(("Search" + suffix).c_str(), benchSearch<Container>, dist),
+			benchmark::RegisterBenchmark(("RangeSearch" + suffix).c_str(), benchRangeSearch<Container>, dist),
+		};
+
+		for(benchmark::internal::Benchmark* bench : benches){
+			for(size_t n = 1000; n <= maxN; n *= 10)
+				bench->Arg((int64_t)n);
+			bench->Unit(benchmark::kNanosecond);
+		}
+	}
+}
+
+int main(int argc, char** argv){
+	const char* env = getenv("SKIPLIST_BENCH_MAX_N");
+	size_t maxN = env ? strtoull(env, NULL, 10) : BENCH_DEFAULT_MAX_N;
+
+	benchRegister<SkiplistContainer>("Skiplist", maxN);
+	benchRegister<PackedSkiplistContainer>("PackedSkiplist", maxN);
+	benchRegister<StdMapContainer<std::map<long,long> > >("std::map", maxN);
+	benchRegister<StdMapContainer<std::multimap<long,long> > >("std::multimap", maxN);
+
+	benchmark::Initialize(&argc, argv);
+	if(benchmark::ReportUnrecognizedArguments(argc, argv)){
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,244 @@
+/*
+  skiplist_epoch.h - epoch based memory reclamation shared by the concurrent Skiplists.
+
+  A thread enters an epoch before it reads shared nodes and exits afterwards.
+  A node removed from a list is retired with the epoch it was removed in,
+  and it is only released after the global epoch moved two steps ahead,
+  i.e. no thread can still be reading it.
+*/
+#ifndef _SKIPLIST_EPOCH_H_
+#define _SKIPLIST_EPOCH_H_
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SKIPLIST_EPOCH_COLLECT_THRESHOLD 64	//how many nodes a thread retires before trying to release them
+
+//A thread that reads nodes of concurrent Skiplists
+struct skiplist_epoch_record_t{
+	std::atomic<uint64_t> state;			//(epoch << 1) | 1 if the thread is in an epoch, 0 otherwise
+	std::atomic<bool> inUse;				//whether this record is owned by a thread
+	int nesting;							//how many times the owner entered without exiting, only accessed by the owner
+	struct skiplist_epoch_record_t* next;	//records are never released, they are reused by new threads
+};
+
+//A retired memory block waiting to be released
+struct skiplist_retired_t{
+	void* ptr;
+	void (*deleter)(void*);		//function that releases the block
+	uint64_t epoch;				//global epoch when the block was retired
+};
+
+//Epoch based reclamation, all Skiplists of a process share the same epochs
+class SkiplistEpoch{
+    private:
+		//the state of a thread, its record is returned and its retired blocks are handed over when the thread exits
+		struct thread_state_t{
+			struct skiplist_epoch_record_t* record;
+			std::vector<struct skiplist_retired_t> retired;
+
+			thread_state_t(): record(NULL){}
+			~thread_state_t(){
+				if(record){
+					record->state.store(0);
+					record->inUse.store(false);
+				}
+				if(!retired.empty()){
+					std::lock_guard<std::mutex> lock(_orphansLock());
+					_orphans().insert(_orphans().end(), retired.begin(), retired.end());
+				}
+			}
+		};
+
+		static std::atomic<uint64_t>& _globalEpoch(){
+			static std::atomic<uint64_t> epoch(1);
+			return epoch;
+		}
+
+		static std::atomic<struct skiplist_epoch_record_t*>& _records(){
+			static std::atomic<struct skiplist_epoch_record_t*> records(NULL);
+			return records;
+		}
+
+		//blocks retired by threads that have exited, the rest are released when the process exits
+		struct orphans_t{
+			std::vector<struct skiplist_retired_t> retired;
+
+			~orphans_t(){
+				for(size_t i = 0; i < retired.size(); i++){
+					retired[i].deleter(retired[i].ptr);
+				}
+			}
+		};
+
+		static std::vector<struct skiplist_retired_t>& _orphans(){
+			static orphans_t orphans;
+			return orphans.retired;
+		}
+
+		static std::mutex& _orphansLock(){
+			static std::mutex lock;
+			return lock;
+		}
+
+		static thread_state_t& _local(){
+			static thread_local thread_state_t local;
+			return local;
+		}
+
+		//take a free record or create a new one
+		static struct skiplist_epoch_record_t* _acquireRecord(){
+			struct skiplist_epoch_record_t* record;
+
+			for(record = _records().load(); record != NULL; record = record->next){
+				bool expected = false;
+				if(!record->inUse.load() && record->inUse.compare_exchange_strong(expected, true)){
+					record->nesting = 0;
+					return record;
+				}
+			}
+
+			record = new struct skiplist_epoch_record_t;
+			record->state.store(0);
+			record->inUse.store(true);
+			record->nesting = 0;
+			record->next = _records().load();
+			while(!_records().compare_exchange_weak(record->next, record));
+
+			return record;
+		}
+
+		//release the blocks in the list that were retired at least two epochs ago
+		static void _release(std::vector<struct skiplist_retired_t>& retired, uint64_t epoch){
+			size_t kept = 0;
+
+			for(size_t i = 0; i < retired.size(); i++){
+				if(retired[i].epoch + 2 <= epoch){
+					retired[i].deleter(retired[i].ptr);
+				}else{
+					retired[kept++] = retired[i];
+				}
+			}
+			retired.resize(kept);
+		}
+
+    public:
+		/*
+		 * Enter an epoch, the nodes read afterwards stay valid until exit is called.
+		 * It can be nested.
+		 */
+		static void enter(){
+			thread_state_t& local = _local();
+
+			if(NULL == local.record){
+				local.record = _acquireRecord();
+			}
+
+			if(local.record->nesting++ > 0){
+				return;
+			}
+
+			//publish the epoch, and make sure the global epoch didn't move before it was published
+			uint64_t epoch = _globalEpoch().load();
+			while(true){
+				local.record->state.store((epoch << 1) | 1);
+
+				uint64_t now = _globalEpoch().load();
+				if(now == epoch){
+					break;
+				}
+				epoch = now;
+			}
+		}
+
+		/*
+		 * Exit the epoch entered by enter
+		 */
+		static void exit(){
+			struct skiplist_epoch_record_t* record = _local().record;
+
+			if(--record->nesting == 0){
+				record->state.store(0, std::memory_order_release);
+			}
+		}
+
+		/*
+		 * Get the global epoch
+		 */
+		static uint64_t current(){
+			return _globalEpoch().load();
+		}
+
+		/*
+		 * Move the global epoch one step ahead if every thread in an epoch has seen the current one
+		 *
+		 * @return
+		 * 		return true if the global epoch is moved
+		 */
+		static bool tryAdvance(){
+			uint64_t epoch = _globalEpoch().load();
+
+			for(struct skiplist_epoch_record_t* record = _records().load(); record != NULL; record = record->next){
+				uint64_t state = record->state.load();
+				if((state & 1) && (state >> 1) != epoch){
+					return false;
+				}
+			}
+
+			return _globalEpoch().compare_exchange_strong(epoch, epoch + 1);
+		}
+
+		/*
+		 * Retire a memory block that is no longer reachable by new readers.
+		 * It's released by the deleter once no reader can hold it.
+		 *
+		 * @param ptr
+		 * 		the memory block
+		 * @param deleter
+		 * 		function that releases the block
+		 */
+		static void retire(void* ptr, void (*deleter)(void*)){
+			thread_state_t& local = _local();
+			struct skiplist_retired_t retired = {ptr, deleter, _globalEpoch().load()};
+
+			local.retired.push_back(retired);
+			if(local.retired.size() % SKIPLIST_EPOCH_COLLECT_THRESHOLD == 0){
+				collect();
+			}
+		}
+
+		/*
+		 * Try to move the epoch and release the blocks retired by this thread,
+		 * and the blocks left by exited threads
+		 */
+		static void collect(){
+			tryAdvance();
+
+			uint64_t epoch = _globalEpoch().load();
+			_release(_local().retired, epoch);
+
+			std::unique_lock<std::mutex> lock(_orphansLock(), std::try_to_lock);
+			if(lock.owns_lock()){
+				_release(_orphans(), epoch);
+			}
+		}
+};
+
+/*
+ * Enter an epoch in the scope
+ */
+class SkiplistEpochGuard{
+    public:
+		SkiplistEpochGuard(){
+			SkiplistEpoch::enter();
+		}
+
+		~SkiplistEpochGuard(){
+			SkiplistEpoch::exit();
+		}
+};
+
+#endif
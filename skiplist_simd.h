@@ -0,0 +1,194 @@
+/*
+  skiplist_simd.h - count the keys of a sorted array that are smaller than a given key with SIMD.
+
+  Used by the key search inside the nodes of PackedSkiplist for 32 and 64 bit integer keys.
+  The AVX2 or SSE4.2 version is picked at runtime from the CPU, other CPUs and compilers use the scalar version.
+  Every key of the array is compared, which is faster than a branchy search over the few keys of a node.
+  The instructions only compare signed integers, so the sign bit of unsigned keys and of the probe is flipped,
+  which keeps their order as signed integers.
+*/
+#ifndef _SKIPLIST_SIMD_H_
+#define _SKIPLIST_SIMD_H_
+
+#include <stdint.h>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SKIPLIST_SIMD_X86
+#include <immintrin.h>
+#endif
+
+//flip is XORed into the keys and the given key before they are compared, the sign bit for unsigned keys, 0 otherwise
+typedef int (*skiplist_count32_func_t)(const int32_t* keys, int count, int32_t key, bool equal, int32_t flip);
+typedef int (*skiplist_count64_func_t)(const int64_t* keys, int count, int64_t key, bool equal, int64_t flip);
+
+/*
+ * Count the keys smaller than a given key, or equal or smaller if equal is true
+ */
+template <class KeyType>
+static inline int skiplistScalarCount(const KeyType* keys, int count, KeyType key, bool equal, KeyType flip){
+	int num = 0;
+
+	key ^= flip;
+	if(equal){
+		for(int i = 0; i < count; i++)
+			num += ((KeyType)(keys[i] ^ flip) <= key);
+	}else{
+		for(int i = 0; i < count; i++)
+			num += ((KeyType)(keys[i] ^ flip) < key);
+	}
+
+	return num;
+}
+
+#ifdef SKIPLIST_SIMD_X86
+__attribute__((target("avx2")))
+static inline int skiplistAvx2Count32(const int32_t* keys, int count, int32_t key, bool equal, int32_t flip){
+	__m256i bias = _mm256_set1_epi32(flip);
+	__m256i probe = _mm256_set1_epi32(key ^ flip);
+	int num = 0, i = 0;
+
+	//keys smaller than the key are key > keys[i], keys larger than the key are keys[i] > key
+	for(; i + 8 <= count; i += 8){
+		__m256i lane = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), bias);
+		__m256i mask = equal ? _mm256_cmpgt_epi32(lane, probe) : _mm256_cmpgt_epi32(probe, lane);
+		num += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+	}
+	if(equal){
+		num = i - num;
+	}
+
+	return num + skiplistScalarCount(keys + i, count - i, key, equal, flip);
+}
+
+__attribute__((target("avx2")))
+static inline int skiplistAvx2Count64(const int64_t* keys, int count, int64_t key, bool equal, int64_t flip){
+	__m256i bias = _mm256_set1_epi64x(flip);
+	__m256i probe = _mm256_set1_epi64x(key ^ flip);
+	int num = 0, i = 0;
+
+	for(; i + 4 <= count; i += 4){
+		__m256i lane = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), bias);
+		__m256i mask = equal ? _mm256_cmpgt_epi64(lane, probe) : _mm256_cmpgt_epi64(probe, lane);
+		num += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+	}
+	if(equal){
+		num = i - num;
+	}
+
+	return num + skiplistScalarCount(keys + i, count - i, key, equal, flip);
+}
+
+__attribute__((target("sse4.2")))
+static inline int skiplistSse42Count32(const int32_t* keys, int count, int32_t key, bool equal, int32_t flip){
+	__m128i bias = _mm_set1_epi32(flip);
+	__m128i probe = _mm_set1_epi32(key ^ flip);
+	int num = 0, i = 0;
+
+	for(; i + 4 <= count; i += 4){
+		__m128i lane = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), bias);
+		__m128i mask = equal ? _mm_cmpgt_epi32(lane, probe) : _mm_cmpgt_epi32(probe, lane);
+		num += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+	}
+	if(equal){
+		num = i - num;
+	}
+
+	return num + skiplistScalarCount(keys + i, count - i, key, equal, flip);
+}
+
+__attribute__((target("sse4.2")))
+static inline int skiplistSse42Count64(const int64_t* keys, int count, int64_t key, bool equal, int64_t flip){
+	__m128i bias = _mm_set1_epi64x(flip);
+	__m128i probe = _mm_set1_epi64x(key ^ flip);
+	int num = 0, i = 0;
+
+	for(; i + 2 <= count; i += 2){
+		__m128i lane = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), bias);
+		__m128i mask = equal ? _mm_cmpgt_epi64(lane, probe) : _mm_cmpgt_epi64(probe, lane);
+		num += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(mask)));
+	}
+	if(equal){
+		num = i - num;
+	}
+
+	return num + skiplistScalarCount(keys + i, count - i, key, equal, flip);
+}
+#endif
+
+/*
+ * Pick the fastest version the CPU supports, only called once
+ */
+static inline skiplist_count32_func_t skiplistSelectCount32(){
+#ifdef SKIPLIST_SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		return skiplistAvx2Count32;
+	}
+	if(__builtin_cpu_supports("sse4.2")){
+		return skiplistSse42Count32;
+	}
+#endif
+	return skiplistScalarCount<int32_t>;
+}
+
+static inline skiplist_count64_func_t skiplistSelectCount64(){
+#ifdef SKIPLIST_SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		return skiplistAvx2Count64;
+	}
+	if(__builtin_cpu_supports("sse4.2")){
+		return skiplistSse42Count64;
+	}
+#endif
+	return skiplistScalarCount<int64_t>;
+}
+
+/*
+ * Whether the keys of a type can be counted by SIMD, i.e. 32 or 64 bit integers
+ */
+template <class KeyType>
+struct skiplist_simd_key_t{
+	static const bool value = std::is_integral<KeyType>::value &&
+		(sizeof(KeyType) == sizeof(int32_t) || sizeof(KeyType) == sizeof(int64_t));
+};
+
+/*
+ * Count the keys of an array that are smaller than a given key, or equal or smaller if equal is true.
+ * The keys have to be sorted, so it's the index of the lower bound, or the upper bound if equal is true.
+ *
+ * @param keys
+ * 		the sorted keys
+ * @param count
+ * 		how many keys in the array
+ * @param key
+ * 		the given key
+ * @param equal
+ * 		whether the keys equal to the given key are counted
+ *
+ * @return
+ * 		the number of keys
+ */
+template <class KeyType>
+static inline typename std::enable_if<skiplist_simd_key_t<KeyType>::value && sizeof(KeyType) == sizeof(int32_t), int>::type
+skiplistSimdCount(const KeyType* keys, int count, KeyType key, bool equal){
+	static const skiplist_count32_func_t func = skiplistSelectCount32();
+	return func((const int32_t*)keys, count, (int32_t)key, equal, std::is_signed<KeyType>::value ? 0 : INT32_MIN);
+}
+
+template <class KeyType>
+static inline typename std::enable_if<skiplist_simd_key_t<KeyType>::value && sizeof(KeyType) == sizeof(int64_t), int>::type
+skiplistSimdCount(const KeyType* keys, int count, KeyType key, bool equal){
+	static const skiplist_count64_func_t func = skiplistSelectCount64();
+	return func((const int64_t*)keys, count, (int64_t)key, equal, std::is_signed<KeyType>::value ? 0 : INT64_MIN);
+}
+
+//other key types never reach here, it only keeps the callers compiling
+template <class KeyType>
+static inline typename std::enable_if<!skiplist_simd_key_t<KeyType>::value, int>::type
+skiplistSimdCount(const KeyType*, int, const KeyType&, bool){
+	return 0;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+  bucket_skiplist_test.cpp - checks BucketSkiplist against std::multimap over random inserts, appends,
+  deletes and range searches, and appends of a value of the same bucket while the bucket grows.
+*/
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bucket_skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 300
+
+typedef BucketSkiplist<int, std::string> list_t;
+typedef std::multimap<int, std::string> model_t;
+
+//the values of the keys within a range, by the range search
+static void checkRange(list_t& list, const model_t& model, int key1, int key2){
+	model_t found;
+	int last = key1;
+	int count = list.search(key1, key2, [&](const int& key, const list_t::handle_t& handle, std::string& value){
+		CHECK(key >= last && key <= key2);
+		CHECK(handle.node->key == key && list.get(handle) == &value);
+		last = key;
+		found.insert(std::make_pair(key, value));
+	});
+	model_t expected(model.lower_bound(key1), model.upper_bound(key2));
+
+	CHECK(count == (int)expected.size());
+	CHECK(sortedNodes(found) == sortedNodes(expected));
+}
+
+//a value that refers to a value of the bucket it's added to, while the bucket grows
+static void checkSelfAppend(){
+	list_t list;
+	list_t::handle_t handle, added;
+	std::string value(100, 'x');
+
+	CHECK(list.insert(1, value, &handle));
+	for(int i = 0; i < 64; i++){
+		CHECK(list.append(handle.node, *list.get(handle), &added));
+		CHECK(*list.get(handle) == value && *list.get(added) == value);
+	}
+	CHECK(list.getKeysNum() == 1 && list.getValuesNum() == 65);
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	list_t list;
+	model_t model;
+	std::vector<list_t::handle_t> handles;
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int key = rng() % KEYS;
+		std::string value = std::to_string(op);
+
+		if(choice < 30){
+			list_t::handle_t handle;
+
+			CHECK(list.insert(key, value, &handle));
+			CHECK(handle.node && handle.node->key == key && *list.get(handle) == value);
+			model.insert(std::make_pair(key, value));
+			handles.push_back(handle);
+		}else if(choice < 50 && !handles.empty()){
+			//append to the node of a value
+			list_t::handle_t handle, other = handles[rng() % handles.size()];
+
+			CHECK(list.append(other.node, std::move(value), &handle));
+			CHECK(handle.node == other.node);
+			model.insert(std::make_pair(handle.node->key, *list.get(handle)));
+			handles.push_back(handle);
+		}else if(choice < 75 && !handles.empty()){
+			size_t i = rng() % handles.size();
+			list_t::handle_t handle = handles[i];
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(handle.node->key);
+
+			while(range.first->second != *list.get(handle)){
+				++range.first;
+			}
+			model.erase(range.first);
+			CHECK(list.del(&handle));
+			CHECK(NULL == handle.node && !list.del(&handle));
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			list_t::node_t* node = list.search(key);
+
+			CHECK((NULL != node) == (model.count(key) > 0));
+			CHECK(NULL == node || node->value.getCount() == (int)model.count(key));
+			checkRange(list, model, key, key + rng() % 20);
+		}
+
+		if(op % 1000 == 0){
+			checkRange(list, model, 0, KEYS);
+			CHECK(list.getValuesNum() == (int)model.size());
+		}
+	}
+
+	//a node is removed with its last value
+	for(size_t i = 0; i < handles.size(); i++){
+		CHECK(list.del(&handles[i]));
+	}
+	CHECK(list.getValuesNum() == 0 && list.getKeysNum() == 0);
+
+	checkSelfAppend();
+
+	std::cout<<"bucket skiplist test passed"<<std::endl;
+
+	return 0;
+}
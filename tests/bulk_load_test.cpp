@@ -0,0 +1,111 @@
+/*
+  bulk_load_test.cpp - builds Skiplist from sorted keys by bulkLoad, checks it against std::multimap
+  and the levels against the deterministic balance, then goes on with insert and del.
+*/
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define NODES 20000
+#define KEYS 5000
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+int main(){
+	std::mt19937 rng(20190913);
+	std::vector<int> keys(NODES), values(NODES);
+	std::vector<node_t*> nodes(NODES, NULL);
+	list_t list;
+	model_t model;
+
+	//sorted keys with duplicates, the values give the order of the nodes in the input
+	for(int i = 0; i < NODES; i++){
+		keys[i] = rng() % KEYS;
+	}
+	std::sort(keys.begin(), keys.end());
+	for(int i = 0; i < NODES; i++){
+		values[i] = i;
+		model.insert(std::make_pair(keys[i], i));
+	}
+
+	CHECK(list.bulkLoad(keys.begin(), values.begin(), NODES, nodes.data()));
+	checkModel(list, model);
+	for(int i = 0; i < NODES; i++){
+		CHECK(nodes[i]->key == keys[i] && nodes[i]->value == i);
+	}
+
+	//the nodes with the same key are in the order of the input
+	for(int key = 0; key < KEYS; key += 7){
+		node_t *start, *end, *node;
+		int last = -1;
+
+		if(list.search(key, &start, &end)){
+			list_each_sl_node(start, end, node){
+				CHECK(node->value > last);
+				last = node->value;
+			}
+		}
+	}
+
+	//the loaded list works as one built by insert
+	for(int i = 0; i < NODES; i += 2){
+		std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(keys[i]);
+
+		while(range.first->second != i){
+			++range.first;
+		}
+		model.erase(range.first);
+		CHECK(list.del(&nodes[i]));
+	}
+	for(int i = 0; i < NODES/2; i++){
+		node_t* node = NULL;
+		int key = rng() % (KEYS*2);
+
+		CHECK(list.insert(key, NODES + i, &node));
+		model.insert(std::make_pair(key, NODES + i));
+	}
+	checkModel(list, model);
+
+	//a list with nodes can't be loaded
+	CHECK(!list.bulkLoad(keys.begin(), values.begin(), NODES));
+
+	//distinct keys are perfectly balanced, every 2^SKIPLIST_LEVEL_SHIFT-th node of a level is at the next level
+	{
+		list_t distinct;
+		std::vector<int> sorted(NODES);
+
+		for(int i = 0; i < NODES; i++){
+			sorted[i] = i*2;
+		}
+		CHECK(distinct.bulkLoad(sorted.begin(), values.begin(), NODES));
+		for(int level = 0; level < distinct.getCurrentLevel(); level++){
+			CHECK(distinct.forEachAtLevel(level, [](node_t*){}) == NODES >> (SKIPLIST_LEVEL_SHIFT*level));
+		}
+		CHECK(0 == (NODES >> (SKIPLIST_LEVEL_SHIFT*distinct.getCurrentLevel())));
+	}
+
+	//keys that are not sorted stop the load, the nodes before them stay
+	{
+		list_t unsorted;
+		std::vector<node_t*> loaded(NODES, NULL);
+		model_t before;
+
+		keys[NODES/2] = -1;
+		for(int i = 0; i < NODES/2; i++){
+			before.insert(std::make_pair(keys[i], i));
+		}
+		CHECK(!unsorted.bulkLoad(keys.begin(), values.begin(), NODES, loaded.data()));
+		checkModel(unsorted, before);
+		CHECK(loaded[NODES/2 - 1] != NULL && loaded[NODES/2] == NULL && loaded[NODES-1] == NULL);
+	}
+
+	std::cout<<"bulk load test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+/*
+  comparator_test.cpp - builds Skiplist with a key compare function, both with the default Compare
+  and with SkiplistFuncComp, and checks that the list keeps the order of the function.
+*/
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define KEYS 1000
+
+//the reverse of the key order
+static int reverseComp(int key1, int key2){
+	return (key1 > key2) ? -1 : ((key1 < key2) ? 1 : 0);
+}
+
+//insert the keys twice, then check the order of the list and the searches
+template <class List>
+static void checkReversed(List& list){
+	struct skiplist_node_t<int,int> *start, *end, *node;
+	std::vector<int> keys;
+	int count = 0;
+
+	for(int i = 0; i < KEYS*2; i++){
+		node = NULL;
+		CHECK(list.insert(i % KEYS, i, &node));
+	}
+	CHECK(list.getNodesNum() == KEYS*2);
+
+	for(typename List::iterator it = list.begin(); it != list.end(); ++it){
+		keys.push_back(it->key);
+	}
+	CHECK((int)keys.size() == KEYS*2);
+	for(size_t i = 1; i < keys.size(); i++){
+		CHECK(keys[i-1] >= keys[i]);
+	}
+
+	//a range follows the order of the function, so it goes from the larger key to the smaller one
+	CHECK(list.search(20, 10, &start, &end));
+	list_each_sl_node(start, end, node){
+		CHECK(node->key <= 20 && node->key >= 10);
+		count++;
+	}
+	CHECK(count == 11*2);
+	CHECK(!list.search(10, 20, &start, &end));
+
+	CHECK(list.search(KEYS/2, &start, &end));
+	CHECK(start != end && start->key == KEYS/2 && end->key == KEYS/2);
+}
+
+int main(){
+	//the spelling of the function pointer constructor before Compare was a template parameter
+	Skiplist<int, int> list(10, reverseComp);
+	Skiplist<int, int, SkiplistFuncComp<int> > funcList(10, reverseComp);
+	Skiplist<int, int> defaultList;
+
+	checkReversed(list);
+	checkReversed(funcList);
+
+	//without the function the default order is kept
+	for(int i = 0; i < KEYS; i++){
+		struct skiplist_node_t<int,int>* node = NULL;
+
+		CHECK(defaultList.insert(KEYS - i, i, &node));
+	}
+	CHECK(defaultList.begin()->key == 1);
+
+	std::cout<<"comparator test passed"<<std::endl;
+
+	return 0;
+}
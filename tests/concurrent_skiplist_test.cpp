@@ -0,0 +1,156 @@
+/*
+  concurrent_skiplist_test.cpp - runs ConcurrentSkiplist with several writers and readers on keys with duplicates,
+  then checks the runs of nodes left for each key, and that the search of a hot key doesn't walk its run.
+*/
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "concurrent_skiplist.h"
+#include "skiplist_epoch.h"
+#include "skiplist_test.h"
+
+#define WRITERS 4
+#define READERS 3
+#define NODES_PER_WRITER 4000
+#define KEYS 1000			//every writer inserts 4 nodes with each key
+#define HOT_KEY 0
+#define HOT_NODES 8000
+
+typedef ConcurrentSkiplist<int, int> list_t;
+typedef struct concurrent_skiplist_node_t<int,int> node_t;
+
+//the values of the nodes with a key, by search and list_each_csl_node
+static std::vector<int> runValues(list_t& list, int key){
+	SkiplistEpochGuard guard;
+	std::vector<int> values;
+	node_t *start, *end, *node;
+
+	if(list.search(key, &start, &end)){
+		list_each_csl_node(list, start, end, node){
+			CHECK(node->key == key);
+			values.push_back(node->value);
+		}
+	}
+	std::sort(values.begin(), values.end());
+
+	return values;
+}
+
+//the key compare that counts its calls
+struct CountingComp{
+	static std::atomic<long> calls;
+
+	int operator()(int key1, int key2) const{
+		calls++;
+		return (key1 < key2) ? -1 : ((key2 < key1) ? 1 : 0);
+	}
+};
+std::atomic<long> CountingComp::calls(0);
+
+/*
+ * A hot key with thousands of duplicates among unique keys, the search finds both ends of its run
+ * without walking it, while the run changes at both ends
+ */
+static void checkHotKey(){
+	typedef ConcurrentSkiplist<int, int, CountingComp> counted_t;
+	counted_t list(16);
+	std::vector<struct concurrent_skiplist_node_t<int,int>*> hot(HOT_NODES, NULL);
+	struct concurrent_skiplist_node_t<int,int> *start, *end, *node;
+
+	for(int i = 0; i < HOT_NODES; i++){
+		struct concurrent_skiplist_node_t<int,int>* unique = NULL;
+
+		CHECK(list.insert(HOT_NODES + i, i, &unique));
+		CHECK(list.insert(HOT_KEY, i, &hot[i]));
+	}
+
+	for(int round = 0; round < 4; round++){
+		SkiplistEpochGuard guard;
+		int count = 0;
+
+		CountingComp::calls = 0;
+		CHECK(list.search(HOT_KEY, &start, &end));
+		CHECK(CountingComp::calls.load() < HOT_NODES/10);
+
+		list_each_csl_node(list, start, end, node){
+			CHECK(node->key == HOT_KEY);
+			count++;
+		}
+		CHECK(count == HOT_NODES - round*2);
+
+		//the first and the last nodes of the run, i.e. the newest and the oldest
+		CHECK(start == hot[HOT_NODES-1 - round] && end == hot[round]);
+		CHECK(list.del(&hot[HOT_NODES-1 - round]));
+		CHECK(list.del(&hot[round]));
+	}
+}
+
+/*
+ * Each writer inserts nodes on all keys, the value of a node is writer*NODES_PER_WRITER + i,
+ * and deletes every other one of its nodes. The readers check that a run of nodes only has the key
+ */
+int main(){
+	list_t list(12);
+	std::atomic<int> running(WRITERS);
+	std::vector<std::thread> threads;
+
+	for(int t = 0; t < WRITERS; t++){
+		threads.emplace_back([&list, &running, t]{
+			std::vector<node_t*> nodes(NODES_PER_WRITER, NULL);
+
+			for(int i = 0; i < NODES_PER_WRITER; i++){
+				CHECK(list.insert(i % KEYS, t*NODES_PER_WRITER + i, &nodes[i]));
+			}
+			for(int i = 0; i < NODES_PER_WRITER; i += 2){
+				CHECK(list.del(&nodes[i]));
+				CHECK(NULL == nodes[i]);
+			}
+			running--;
+		});
+	}
+
+	for(int t = 0; t < READERS; t++){
+		threads.emplace_back([&list, &running, t]{
+			std::mt19937 rng(t);
+
+			while(running.load() > 0){
+				int key = rng() % KEYS;
+				std::vector<int> values = runValues(list, key);
+
+				CHECK(values.size() <= WRITERS*NODES_PER_WRITER/KEYS);
+				for(size_t i = 0; i < values.size(); i++){
+					CHECK(values[i] % NODES_PER_WRITER % KEYS == key);
+				}
+			}
+		});
+	}
+
+	for(size_t i = 0; i < threads.size(); i++){
+		threads[i].join();
+	}
+
+	//the nodes with an odd index are left
+	CHECK(list.getNodesNum() == NODES_PER_WRITER/2*WRITERS);
+	for(int key = 0; key < KEYS; key++){
+		std::vector<int> expected;
+
+		for(int t = 0; t < WRITERS; t++){
+			for(int i = key; i < NODES_PER_WRITER; i += KEYS){
+				if(i % 2 == 1){
+					expected.push_back(t*NODES_PER_WRITER + i);
+				}
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		CHECK(runValues(list, key) == expected);
+	}
+
+	checkHotKey();
+
+	std::cout<<"concurrent skiplist test passed"<<std::endl;
+
+	return 0;
+}
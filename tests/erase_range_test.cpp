@@ -0,0 +1,196 @@
+/*
+  erase_range_test.cpp - checks eraseRange against std::multimap, where its visitor drops the handles of the removed nodes,
+  and erases ranges of a SWMR Skiplist while readers search it.
+*/
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 500
+#define READERS 3
+#define SWMR_KEYS 500
+#define SWMR_OPS 4000
+#define GAP 1000
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+/*
+ * The value of a node is its index in the handles. The visitor checks that the nodes come in key order
+ * and drops their handles, which are reinserted later
+ */
+static int eraseChecked(list_t& list, model_t& model, std::vector<node_t*>& handles, int key1, int key2){
+	int expected = (key1 <= key2) ? countModel(model, key1, key2) : 0;
+	int visited = 0;
+	int prev = key1;
+	int removed = list.eraseRange(key1, key2, [&](node_t* node){
+		CHECK(node->key >= key1 && node->key <= key2 && node->key >= prev);
+		CHECK(handles[node->value] == node);
+		prev = node->key;
+		handles[node->value] = NULL;
+		visited++;
+	});
+
+	CHECK(removed == expected && visited == expected);
+	if(key1 <= key2){
+		model.erase(model.lower_bound(key1), model.upper_bound(key2));
+	}
+
+	return removed;
+}
+
+static void checkModelErase(){
+	std::mt19937 rng(20220405);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles(KEYS*4, NULL);
+	node_t *start, *end;
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int i = rng() % handles.size();
+		int key = rng() % KEYS;
+
+		if(choice < 60){
+			//a dropped handle is reinserted
+			if(NULL == handles[i]){
+				CHECK(list.insert(key, i, &handles[i]));
+				model.insert(std::make_pair(key, i));
+			}
+		}else if(choice < 80){
+			if(handles[i]){
+				std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(handles[i]->key);
+				model_t::iterator found = std::find_if(range.first, range.second,
+					[i](const std::pair<const int,int>& entry){ return entry.second == i; });
+
+				CHECK(found != range.second);
+				model.erase(found);
+				CHECK(list.del(&handles[i]));
+			}
+		}else if(choice < 98){
+			eraseChecked(list, model, handles, key, key + rng() % 20);
+		}else{
+			//an empty range
+			CHECK(0 == eraseChecked(list, model, handles, key, key - 1 - rng() % 20));
+		}
+
+		if(op % 500 == 0){
+			checkModel(list, model);
+		}
+	}
+	checkModel(list, model);
+
+	//the ranges past both ends, then the whole list
+	CHECK(0 == eraseChecked(list, model, handles, -100, -1));
+	CHECK(0 == eraseChecked(list, model, handles, KEYS, KEYS + 100));
+	eraseChecked(list, model, handles, -100, KEYS/2);
+	checkModel(list, model);
+	eraseChecked(list, model, handles, -100, KEYS + 100);
+	checkModel(list, model);
+	CHECK(list.begin() == list.end());
+	CHECK(!list.search(0, KEYS, &start, &end));
+	for(size_t i = 0; i < handles.size(); i++){
+		CHECK(NULL == handles[i]);
+	}
+
+	//the list is still usable
+	CHECK(list.insert(7, 0, &handles[0]));
+	CHECK(list.search(7, &start, &end) && start == handles[0] && end == handles[0]);
+}
+
+/*
+ * The keys GAP*i stay in the list, and the writer inserts keys between them and erases ranges within the gaps.
+ * The readers check that the kept keys are found, and that scans from lower_bound see the keys in order
+ */
+static void checkSwmrErase(){
+	typedef Skiplist<int, int, SkiplistDefaultComp<int>, SkiplistSlabAllocator, SkiplistSwmrSync> swmr_t;
+	swmr_t list;
+	model_t between;		//the keys between the kept keys
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> readers;
+
+	for(int i = 0; i < SWMR_KEYS; i++){
+		node_t* node = NULL;
+
+		CHECK(list.insert(GAP*i, GAP*i, &node));
+	}
+
+	for(int t = 0; t < READERS; t++){
+		readers.emplace_back([&list, &stop, t]{
+			std::mt19937 rng(t);
+
+			while(!stop.load()){
+				SkiplistEpochGuard guard;
+				node_t *start, *end;
+				int key = GAP*(rng() % SWMR_KEYS);
+				int prev = key - 1;
+				int scanned = 0;
+
+				CHECK(list.search(key, &start, &end));
+				CHECK(start->key == key && start->value == key);
+				for(swmr_t::iterator it = list.lower_bound(key); it != list.end() && scanned < 32; ++it, scanned++){
+					CHECK(it->key >= prev && it->value == it->key);	//the keys between may have duplicates
+					prev = it->key;
+				}
+			}
+		});
+	}
+
+	std::mt19937 rng(SWMR_OPS);
+	for(int op = 0; op < SWMR_OPS; op++){
+		int i = rng() % SWMR_KEYS;
+
+		if(rng() % 2){
+			for(int j = 0; j < 8; j++){
+				node_t* node = NULL;
+				int key = GAP*i + 1 + rng() % (GAP - 1);
+
+				CHECK(list.insert(key, key, &node));
+				between.insert(std::make_pair(key, key));
+			}
+		}else{
+			//a range inside the gap after a kept key
+			int key1 = GAP*i + 1 + rng() % (GAP - 1);
+			int key2 = std::min(key1 + (int)(rng() % GAP), GAP*(i + 1) - 1);
+			int removed = countModel(between, key1, key2);
+
+			between.erase(between.lower_bound(key1), between.upper_bound(key2));
+			CHECK(list.eraseRange(key1, key2) == removed);
+		}
+	}
+
+	stop.store(true);
+	for(size_t i = 0; i < readers.size(); i++){
+		readers[i].join();
+	}
+
+	CHECK(list.getNodesNum() == SWMR_KEYS + (int)between.size());
+	for(int i = 0; i < SWMR_KEYS; i++){
+		node_t *start, *end, *node;
+		int count = 0;
+
+		if(list.search(GAP*i + 1, GAP*(i + 1) - 1, &start, &end)){
+			list_each_sl_node(start, end, node){
+				count++;
+			}
+		}
+		CHECK(count == countModel(between, GAP*i + 1, GAP*(i + 1) - 1));
+	}
+}
+
+int main(){
+	checkModelErase();
+	checkSwmrErase();
+
+	std::cout<<"erase range test passed"<<std::endl;
+
+	return 0;
+}
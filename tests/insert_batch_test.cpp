@@ -0,0 +1,92 @@
+/*
+  insert_batch_test.cpp - checks insertBatch against std::multimap for sorted batches, unsorted batches
+  and batches of keys that are already in the list, mixed with del.
+*/
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define KEYS 3000
+#define BATCH 400
+#define BATCHES 50
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+int main(){
+	std::mt19937 rng(20190913);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;
+
+	for(int batch = 0; batch < BATCHES; batch++){
+		std::vector<int> keys(BATCH), values(BATCH);
+		std::vector<node_t*> nodes(BATCH, NULL);
+
+		for(int i = 0; i < BATCH; i++){
+			keys[i] = rng() % KEYS;
+			values[i] = batch*BATCH + i;
+		}
+		if(batch % 3 != 0){
+			std::sort(keys.begin(), keys.end());
+		}
+
+		CHECK(list.insertBatch(keys.begin(), values.begin(), BATCH, nodes.data()));
+		for(int i = 0; i < BATCH; i++){
+			CHECK(nodes[i] && nodes[i]->key == keys[i] && nodes[i]->value == values[i]);
+			model.insert(std::make_pair(keys[i], values[i]));
+		}
+		handles.insert(handles.end(), nodes.begin(), nodes.end());
+
+		//a batch can't reinsert its nodes
+		CHECK(!list.insertBatch(keys.begin(), values.begin(), BATCH, nodes.data()));
+
+		//delete a third of the nodes between the batches
+		for(int i = 0; i < BATCH/3; i++){
+			size_t j = rng() % handles.size();
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(handles[j]->key);
+
+			while(range.first->second != handles[j]->value){
+				++range.first;
+			}
+			model.erase(range.first);
+			CHECK(list.del(&handles[j]));
+			handles[j] = handles.back();
+			handles.pop_back();
+		}
+		checkModel(list, model);
+	}
+
+	//a batch inserts the same nodes as insert, with the same seed the lists have the same levels
+	{
+		list_t batched(DEFAULT_MAX_LEVEL, SkiplistDefaultComp<int>(), 7), inserted(DEFAULT_MAX_LEVEL, SkiplistDefaultComp<int>(), 7);
+		std::vector<int> keys(BATCH);
+		std::vector<node_t*> nodes(BATCH, NULL);
+
+		for(int i = 0; i < BATCH; i++){
+			keys[i] = i / 3;
+		}
+		CHECK(batched.insertBatch(keys.begin(), keys.begin(), BATCH, nodes.data()));
+		for(int i = 0; i < BATCH; i++){
+			node_t* node = NULL;
+			CHECK(inserted.insert(keys[i], keys[i], &node));
+		}
+		for(int level = 0; level < inserted.getCurrentLevel(); level++){
+			std::vector<int> batchedKeys, insertedKeys;
+
+			batched.forEachAtLevel(level, [&](node_t* node){ batchedKeys.push_back(node->key); });
+			inserted.forEachAtLevel(level, [&](node_t* node){ insertedKeys.push_back(node->key); });
+			CHECK(batchedKeys == insertedKeys);
+		}
+		CHECK(batched.getCurrentLevel() == inserted.getCurrentLevel());
+	}
+
+	std::cout<<"insert batch test passed"<<std::endl;
+
+	return 0;
+}
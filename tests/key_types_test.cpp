@@ -0,0 +1,199 @@
+/*
+  key_types_test.cpp - checks Skiplist with std::string keys and values against std::multimap,
+  with move inserts, emplace and lookups by std::string_view, and that a key or a value whose
+  constructor throws leaves the list and its allocator as they were.
+*/
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 300
+
+typedef Skiplist<std::string, std::string, SkiplistTransparentComp> list_t;
+typedef std::multimap<std::string, std::string> model_t;
+typedef struct skiplist_node_t<std::string,std::string> node_t;
+
+//the lookups by std::string_view find as many nodes as the model has
+static void checkLookups(list_t& list, const model_t& model, const std::string& key){
+	std::string_view view(key);
+	node_t *start, *end, *node;
+	int count = 0;
+
+	if(list.search(view, &start, &end)){
+		list_each_sl_node(start, end, node){
+			CHECK(node->key == key);
+			count++;
+		}
+	}
+	CHECK(count == (int)model.count(key));
+
+	std::pair<list_t::iterator, list_t::iterator> range = list.equal_range(view);
+	CHECK((int)std::distance(range.first, range.second) == count);
+
+	list_t::iterator lower = list.lower_bound(view), upper = list.upper_bound(view);
+	CHECK(lower == range.first && upper == range.second);
+	CHECK(lower == list.end() ? model.lower_bound(key) == model.end() : lower->key == model.lower_bound(key)->first);
+}
+
+static void checkStrings(){
+	std::mt19937 rng(20190913);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		std::string key = "key" + std::to_string(rng() % KEYS);
+		node_t* node = NULL;
+
+		if(choice < 20){
+			std::string value = std::to_string(op);
+
+			CHECK(list.insert(key, value, &node));
+			model.insert(std::make_pair(key, value));
+			handles.push_back(node);
+		}else if(choice < 40){
+			std::string moved = key, value(40, 'a' + op % 26);
+
+			model.insert(std::make_pair(key, value));
+			CHECK(list.insert(std::move(moved), std::move(value), &node));
+			CHECK(node->key == key);
+			handles.push_back(node);
+		}else if(choice < 50){
+			//the value is constructed from the arguments in the node
+			CHECK(list.emplace(&node, key, (size_t)(op % 50), 'v'));
+			CHECK(node->value == std::string(op % 50, 'v'));
+			model.insert(std::make_pair(key, node->value));
+			handles.push_back(node);
+		}else if(choice < 75 && !handles.empty()){
+			size_t i = rng() % handles.size();
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(handles[i]->key);
+
+			while(range.first->second != handles[i]->value){
+				++range.first;
+			}
+			model.erase(range.first);
+			CHECK(list.del(&handles[i]));
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			checkLookups(list, model, key);
+		}
+
+		if(op % 1000 == 0){
+			checkModel(list, model);
+		}
+	}
+	checkModel(list, model);
+}
+
+//a key whose copy throws when the countdown reaches 0
+struct ThrowingKey{
+	static int countdown;
+	int key;
+
+	ThrowingKey(int key): key(key){}
+
+	ThrowingKey(const ThrowingKey& other): key(other.key){
+		if(countdown > 0 && 0 == --countdown){
+			throw std::runtime_error("key copy");
+		}
+	}
+
+	bool operator<(const ThrowingKey& other) const{
+		return key < other.key;
+	}
+};
+int ThrowingKey::countdown = 0;
+
+//a value whose construction from an int throws for negative ints
+struct ThrowingValue{
+	int value;
+
+	ThrowingValue(int value): value(value){
+		if(value < 0){
+			throw std::runtime_error("value");
+		}
+	}
+};
+
+//the malloc allocator policy, counting the blocks that are not deallocated
+struct CountingAllocator{
+	static int blocks;
+
+	void* allocate(size_t size, int /*sizeClass*/){
+		blocks++;
+		return malloc(size);
+	}
+
+	void deallocate(void* ptr, size_t /*size*/, int /*sizeClass*/){
+		blocks--;
+		free(ptr);
+	}
+
+	void reserve(size_t /*size*/, int /*num*/){
+	}
+
+	bool merge(CountingAllocator& /*other*/){
+		return true;
+	}
+};
+int CountingAllocator::blocks = 0;
+
+static void checkThrows(){
+	typedef Skiplist<ThrowingKey, ThrowingValue, SkiplistDefaultComp<ThrowingKey>, CountingAllocator> throwing_t;
+	throwing_t list;
+	struct skiplist_node_t<ThrowingKey,ThrowingValue>* node;
+	int level, blocks;
+
+	for(int i = 0; i < 1000; i++){
+		node = NULL;
+		CHECK(list.emplace(&node, ThrowingKey(i % 500), i));
+	}
+	level = list.getCurrentLevel();
+	blocks = CountingAllocator::blocks;
+
+	//a new key and a duplicate key, with the key and then the value throwing
+	for(int key = 1000; key >= 0; key -= 1000){
+		bool thrown = false;
+
+		ThrowingKey::countdown = 1;
+		node = NULL;
+		try{
+			list.emplace(&node, (const ThrowingKey&)ThrowingKey(key), 1);
+		}catch(const std::runtime_error&){
+			thrown = true;
+		}
+		CHECK(thrown && NULL == node);
+
+		thrown = false;
+		try{
+			list.emplace(&node, ThrowingKey(key), -1);
+		}catch(const std::runtime_error&){
+			thrown = true;
+		}
+		CHECK(thrown && NULL == node);
+	}
+	ThrowingKey::countdown = 0;
+
+	CHECK(list.getNodesNum() == 1000 && list.getCurrentLevel() == level);
+	//a duplicate key may have moved from its inline tail to a tail cell
+	CHECK(CountingAllocator::blocks - blocks <= 1);
+	CHECK(std::distance(list.begin(), list.end()) == 1000);
+}
+
+int main(){
+	checkStrings();
+	checkThrows();
+
+	std::cout<<"key types test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+/*
+  mvcc_skiplist_test.cpp - checks the snapshots of MvccSkiplist against copies of a std::multimap taken at the same versions,
+  that gc keeps the nodes the registered snapshots see, and runs readers on snapshots while the writer goes on.
+*/
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "mvcc_skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 500
+#define READERS 3
+#define LIVE_NODES 2000
+#define WRITER_OPS 20000
+
+typedef MvccSkiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+
+//the nodes a snapshot sees, by forEach and by the searches of a range and a key
+static void checkSnapshot(list_t& list, uint64_t snapshot, const model_t& model, int key){
+	model_t seen;
+	int prev = -1;
+
+	CHECK(list.forEach(snapshot, [&](int k, int v){
+		CHECK(k >= prev);
+		prev = k;
+		seen.insert(std::make_pair(k, v));
+	}) == (int)model.size());
+	CHECK(sortedNodes(seen) == sortedNodes(model));
+
+	seen.clear();
+	CHECK(list.search(snapshot, key, key + 20, [&](int k, int v){
+		seen.insert(std::make_pair(k, v));
+	}) == countModel(model, key, key + 20));
+	CHECK(sortedNodes(seen) == sortedNodes(model_t(model.lower_bound(key), model.upper_bound(key + 20))));
+
+	CHECK(list.search(snapshot, key, [](int, int){}) == (model.count(key) > 0));
+}
+
+/*
+ * The snapshots are taken at random versions, each with a copy of the model at that time,
+ * and they are checked and released while the writer goes on
+ */
+static void checkSnapshots(){
+	std::mt19937 rng(20200817);
+	list_t list;
+	model_t model;
+	std::vector<list_t::node_t*> handles;
+	std::map<uint64_t, model_t> snapshots;
+	std::vector<uint64_t> deleted;		//the versions of the deletes
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int key = rng() % KEYS;
+
+		if(choice < 55 || handles.empty()){
+			list_t::node_t* node = NULL;
+
+			CHECK(list.insert(key, op, &node));
+			model.insert(std::make_pair(key, op));
+			handles.push_back(node);
+		}else if(choice < 95){
+			size_t i = rng() % handles.size();
+			list_t::node_t* node = handles[i];
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(node->key);
+			model_t::iterator found = std::find_if(range.first, range.second,
+				[node](const std::pair<const int,int>& entry){ return entry.second == node->value.value; });
+
+			CHECK(found != range.second);
+			model.erase(found);
+			CHECK(list.del(&handles[i]));
+			CHECK(NULL == handles[i]);
+			deleted.push_back(list.getVersion());
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else if(choice < 98 || snapshots.empty()){
+			uint64_t snapshot = list.snapshot();
+
+			CHECK(snapshot == list.getVersion());
+			//a snapshot at the same version as a registered one is registered again, and released once
+			if(snapshots.count(snapshot)){
+				list.release(snapshot);
+			}
+			snapshots[snapshot] = model;
+		}else{
+			std::map<uint64_t, model_t>::iterator it = snapshots.begin();
+
+			std::advance(it, rng() % snapshots.size());
+			checkSnapshot(list, it->first, it->second, key);
+			list.release(it->first);
+			snapshots.erase(it);
+		}
+
+		if(op % 1000 == 0){
+			for(std::map<uint64_t, model_t>::iterator it = snapshots.begin(); it != snapshots.end(); ++it){
+				checkSnapshot(list, it->first, it->second, key);
+			}
+			checkSnapshot(list, list.getVersion(), model, key);
+		}
+	}
+
+	//gc keeps the deleted nodes that the oldest snapshot still sees
+	uint64_t oldest = snapshots.empty() ? list.getVersion() : snapshots.begin()->first;
+	int kept = 0;
+
+	list.gc();
+	for(size_t i = 0; i < deleted.size(); i++){
+		kept += (deleted[i] > oldest);
+	}
+	CHECK(list.getNodesNum() == (int)model.size() + kept);
+	for(std::map<uint64_t, model_t>::iterator it = snapshots.begin(); it != snapshots.end(); ++it){
+		checkSnapshot(list, it->first, it->second, 0);
+	}
+
+	//once all are released, gc removes all deleted nodes
+	for(std::map<uint64_t, model_t>::iterator it = snapshots.begin(); it != snapshots.end(); ++it){
+		list.release(it->first);
+	}
+	list.gc();
+	CHECK(list.getNodesNum() == (int)model.size());
+	checkSnapshot(list, list.getVersion(), model, 0);
+
+	//a deleted node can't be deleted again
+	list_t::node_t* removed = NULL;
+	CHECK(!list.del(&removed));
+}
+
+/*
+ * The writer replaces a node by inserting a new one and then deleting an old one,
+ * so a snapshot sees LIVE_NODES nodes, or one more between the two writes.
+ * Readers scan a snapshot twice and get the same nodes, while gc removes the nodes no snapshot sees
+ */
+static void checkReaders(){
+	list_t list;
+	std::vector<list_t::node_t*> handles(LIVE_NODES, NULL);
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> readers;
+
+	for(int i = 0; i < LIVE_NODES; i++){
+		CHECK(list.insert(i, i, &handles[i]));
+	}
+
+	for(int t = 0; t < READERS; t++){
+		readers.emplace_back([&list, &stop, t]{
+			std::mt19937 rng(t);
+			uint64_t last = 0;
+
+			while(!stop.load()){
+				uint64_t snapshot = list.snapshot();
+				std::vector<std::pair<int, int> > first, second;
+
+				CHECK(snapshot >= last);
+				last = snapshot;
+
+				list.forEach(snapshot, [&](int k, int v){ first.push_back(std::make_pair(k, v)); });
+				CHECK(first.size() == LIVE_NODES || first.size() == LIVE_NODES + 1);
+				CHECK(std::is_sorted(first.begin(), first.end(),
+					[](const std::pair<int, int>& node1, const std::pair<int, int>& node2){ return node1.first < node2.first; }));
+
+				//the writer goes on meanwhile
+				std::this_thread::yield();
+				list.forEach(snapshot, [&](int k, int v){ second.push_back(std::make_pair(k, v)); });
+				CHECK(first == second);
+
+				int key = rng() % LIVE_NODES;
+				CHECK(list.search(snapshot, key, key + 9, [](int, int){}) ==
+					(int)(std::lower_bound(first.begin(), first.end(), std::make_pair(key + 10, INT32_MIN)) -
+						std::lower_bound(first.begin(), first.end(), std::make_pair(key, INT32_MIN))));
+
+				list.release(snapshot);
+			}
+		});
+	}
+
+	std::mt19937 rng(WRITER_OPS);
+	for(int op = 0; op < WRITER_OPS; op++){
+		int i = rng() % LIVE_NODES;
+		list_t::node_t* node = NULL;
+
+		CHECK(list.insert(rng() % LIVE_NODES, LIVE_NODES + op, &node));
+		CHECK(list.del(&handles[i]));
+		handles[i] = node;
+
+		if(op % 256 == 0){
+			list.gc();
+		}
+	}
+
+	stop.store(true);
+	for(size_t i = 0; i < readers.size(); i++){
+		readers[i].join();
+	}
+
+	list.gc();
+	CHECK(list.getNodesNum() == LIVE_NODES);
+}
+
+int main(){
+	checkSnapshots();
+	checkReaders();
+
+	std::cout<<"mvcc skiplist test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+  packed_skiplist_test.cpp - checks the SIMD key counts against std::lower_bound and std::upper_bound,
+  and PackedSkiplist against std::multimap, for signed and unsigned 32 and 64 bit keys
+  around the sign bit, and for a key compare functor that is searched without SIMD.
+*/
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "packed_skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 2000
+#define STRIDE 7			//keys are STRIDE apart, so the searches also probe keys that are not in the list
+
+//the keys from the middle of the range of the type, i.e. around 0 for signed types and the sign bit for unsigned ones
+template <class KeyType>
+static KeyType keyAt(int i){
+	KeyType middle = std::is_signed<KeyType>::value ? 0 : (KeyType)((KeyType)1 << (sizeof(KeyType)*8 - 1));
+
+	return (KeyType)(middle + (KeyType)((int64_t)(i - KEYS/2) * STRIDE));
+}
+
+//count with every version the CPU has, for arrays of each length up to a node and a half
+template <class KeyType, class Func>
+static void checkCount(Func func, KeyType flip, std::mt19937& rng){
+	for(int count = 0; count <= SKIPLIST_PACKED_NODE_KEYS*3/2; count++){
+		std::vector<KeyType> keys(count);
+
+		for(int i = 0; i < count; i++){
+			keys[i] = keyAt<KeyType>(rng() % 40);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		for(int i = 0; i < 42; i++){
+			KeyType key = keyAt<KeyType>(i - 1) + (KeyType)(rng() % 2);
+
+			CHECK(func(keys.data(), count, key, false, flip) == (int)(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()));
+			CHECK(func(keys.data(), count, key, true, flip) == (int)(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin()));
+		}
+	}
+}
+
+template <class KeyType>
+static void checkCounts(std::mt19937& rng){
+	typedef typename std::conditional<sizeof(KeyType) == sizeof(int32_t), int32_t, int64_t>::type lane_t;
+	lane_t flip = std::is_signed<KeyType>::value ? 0 : (lane_t)((uint64_t)1 << (sizeof(KeyType)*8 - 1));
+	std::vector<KeyType> keys;
+
+	checkCount<lane_t>([](const lane_t* keys, int count, lane_t key, bool equal, lane_t flip){
+		return skiplistScalarCount(keys, count, key, equal, flip);
+	}, flip, rng);
+
+#ifdef SKIPLIST_SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2")){
+		checkCount<lane_t>([](const lane_t* keys, int count, lane_t key, bool equal, lane_t flip){
+			if(sizeof(lane_t) == sizeof(int32_t)){
+				return skiplistSse42Count32((const int32_t*)keys, count, (int32_t)key, equal, (int32_t)flip);
+			}
+			return skiplistSse42Count64((const int64_t*)keys, count, (int64_t)key, equal, (int64_t)flip);
+		}, flip, rng);
+	}
+	if(__builtin_cpu_supports("avx2")){
+		checkCount<lane_t>([](const lane_t* keys, int count, lane_t key, bool equal, lane_t flip){
+			if(sizeof(lane_t) == sizeof(int32_t)){
+				return skiplistAvx2Count32((const int32_t*)keys, count, (int32_t)key, equal, (int32_t)flip);
+			}
+			return skiplistAvx2Count64((const int64_t*)keys, count, (int64_t)key, equal, (int64_t)flip);
+		}, flip, rng);
+	}
+#endif
+
+	//the version picked for the key type
+	for(int i = 0; i < SKIPLIST_PACKED_NODE_KEYS; i++){
+		keys.push_back(keyAt<KeyType>(i*2));
+	}
+	for(int i = -1; i <= SKIPLIST_PACKED_NODE_KEYS*2; i++){
+		KeyType key = keyAt<KeyType>(i);
+
+		CHECK(skiplistSimdCount(keys.data(), (int)keys.size(), key, false) == (int)(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()));
+		CHECK(skiplistSimdCount(keys.data(), (int)keys.size(), key, true) == (int)(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin()));
+	}
+}
+
+//the keys of the list in order, and the counts of the bounds of a key against the model
+template <class List, class KeyType>
+static void checkList(List& list, const std::multimap<KeyType, int>& model, KeyType key){
+	typename List::iterator lower = list.lower_bound(key), upper = list.upper_bound(key), it;
+	typename std::multimap<KeyType, int>::const_iterator modelLower = model.lower_bound(key);
+	int count = 0;
+
+	for(it = lower; it != upper; ++it){
+		CHECK(it.key() == key);
+		count++;
+	}
+	CHECK(count == (int)model.count(key));
+	CHECK(lower == list.end() ? modelLower == model.end() : lower.key() == modelLower->first);
+	CHECK((list.find(key) != list.end()) == (count > 0));
+}
+
+template <class KeyType, class Compare>
+static void checkPacked(std::mt19937& rng){
+	typedef PackedSkiplist<KeyType, int, SKIPLIST_PACKED_NODE_KEYS, Compare> list_t;
+	list_t list(DEFAULT_MAX_LEVEL, Compare(), 1);
+	std::multimap<KeyType, int> model;
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		KeyType key = keyAt<KeyType>(rng() % KEYS);
+
+		if(choice < 55){
+			CHECK(list.insert(key, op));
+			model.insert(std::make_pair(key, op));
+		}else if(choice < 80){
+			CHECK(list.erase(key) == (model.count(key) > 0));
+			if(model.count(key)){
+				model.erase(model.find(key));
+			}
+		}else{
+			checkList(list, model, key);
+			checkList(list, model, (KeyType)(key + 1));
+		}
+	}
+
+	std::vector<KeyType> keys;
+	for(typename list_t::iterator it = list.begin(); it != list.end(); ++it){
+		keys.push_back(it.key());
+	}
+	CHECK((int)keys.size() == list.getKeysNum() && list.getKeysNum() == (int)model.size());
+	CHECK(std::is_sorted(keys.begin(), keys.end()));
+	for(typename std::multimap<KeyType, int>::iterator it = model.begin(); it != model.end(); ++it){
+		CHECK(std::binary_search(keys.begin(), keys.end(), it->first));
+	}
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+
+	checkCounts<int32_t>(rng);
+	checkCounts<uint32_t>(rng);
+	checkCounts<int64_t>(rng);
+	checkCounts<uint64_t>(rng);
+
+	checkPacked<int32_t, SkiplistDefaultComp<int32_t> >(rng);
+	checkPacked<uint32_t, SkiplistDefaultComp<uint32_t> >(rng);
+	checkPacked<int64_t, SkiplistDefaultComp<int64_t> >(rng);
+	checkPacked<uint64_t, SkiplistDefaultComp<uint64_t> >(rng);
+	checkPacked<uint32_t, SkiplistLessComp<uint32_t> >(rng);
+
+	std::cout<<"packed skiplist test passed"<<std::endl;
+
+	return 0;
+}
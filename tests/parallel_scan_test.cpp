@@ -0,0 +1,160 @@
+/*
+  parallel_scan_test.cpp - checks parallelForEach and parallelReduce against a scan by one thread over random ranges
+  with several thread counts, and scans a SWMR Skiplist while its writer runs.
+*/
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+#include "skiplist_test.h"
+
+#define NODES 20000
+#define KEYS 5000
+#define RANGES 200
+#define SWMR_KEYS 4000
+#define SWMR_SCANS 200
+
+typedef Skiplist<int, int> list_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//the values of a range in the order of a scan by one thread
+static std::vector<int> scanValues(list_t& list, int key1, int key2){
+	std::vector<int> values;
+	node_t *start, *end, *node;
+
+	if(list.search(key1, key2, &start, &end)){
+		list_each_sl_node(start, end, node){
+			values.push_back(node->value);
+		}
+	}
+
+	return values;
+}
+
+//every node of the range is visited once, and no other node
+static void checkForEach(list_t& list, int key1, int key2, int threads){
+	std::vector<std::atomic<int> > visits(NODES);
+	std::vector<int> values = scanValues(list, key1, key2);
+
+	for(int i = 0; i < NODES; i++){
+		visits[i] = 0;
+	}
+	CHECK(list.parallelForEach(key1, key2, [&](const node_t* node){
+		CHECK(node->key >= key1 && node->key <= key2);
+		visits[node->value]++;
+	}, threads) == (int)values.size());
+
+	for(size_t i = 0; i < values.size(); i++){
+		CHECK(visits[values[i]] == 1);
+		visits[values[i]] = 0;
+	}
+	for(int i = 0; i < NODES; i++){
+		CHECK(visits[i] == 0);
+	}
+}
+
+//a sum, and a concatenation, which isn't commutative, so the chunks have to be combined in order
+static void checkReduce(list_t& list, int key1, int key2, int threads){
+	std::vector<int> values = scanValues(list, key1, key2);
+	long sum = 0;
+
+	for(size_t i = 0; i < values.size(); i++){
+		sum += values[i];
+	}
+	CHECK(list.parallelReduce(key1, key2, 0L,
+		[](long result, const node_t* node){ return result + node->value; },
+		[](long result1, long result2){ return result1 + result2; }, threads) == sum);
+
+	CHECK(list.parallelReduce(key1, key2, std::vector<int>(),
+		[](std::vector<int> result, const node_t* node){ result.push_back(node->value); return result; },
+		[](std::vector<int> result1, const std::vector<int>& result2){
+			result1.insert(result1.end(), result2.begin(), result2.end());
+			return result1;
+		}, threads) == values);
+}
+
+/*
+ * The even keys stay in the list, and the writer inserts and deletes the odd keys,
+ * the scans of the calling thread count the even keys of a range
+ */
+static void checkSwmrScan(){
+	typedef Skiplist<int, int, SkiplistDefaultComp<int>, SkiplistSlabAllocator, SkiplistSwmrSync> swmr_t;
+	swmr_t list;
+	std::atomic<bool> stop(false);
+
+	for(int i = 0; i < SWMR_KEYS; i++){
+		node_t* node = NULL;
+
+		CHECK(list.insert(2*i, 2*i, &node));
+	}
+
+	std::thread writer([&list, &stop]{
+		std::vector<node_t*> odd(SWMR_KEYS, NULL);
+		std::mt19937 rng(SWMR_KEYS);
+
+		while(!stop.load()){
+			int i = rng() % SWMR_KEYS;
+
+			if(NULL == odd[i]){
+				CHECK(list.insert(2*i + 1, 2*i + 1, &odd[i]));
+			}else{
+				CHECK(list.del(&odd[i]));
+			}
+		}
+	});
+
+	std::mt19937 rng(SWMR_SCANS);
+	for(int scan = 0; scan < SWMR_SCANS; scan++){
+		SkiplistEpochGuard guard;
+		int key1 = rng() % (2*SWMR_KEYS);
+		int key2 = key1 + rng() % (2*SWMR_KEYS);
+		int even = std::min(key2, 2*SWMR_KEYS - 1)/2 - (key1 + 1)/2 + 1;
+
+		CHECK(list.parallelReduce(key1, key2, 0,
+			[](int result, const node_t* node){ return result + (node->key % 2 == 0); },
+			[](int result1, int result2){ return result1 + result2; }, 3) == even);
+	}
+
+	stop.store(true);
+	writer.join();
+}
+
+int main(){
+	std::mt19937 rng(20210520);
+	list_t list;
+	int threadNums[] = {1, 2, 4, 7};
+
+	//the value of a node is its index
+	for(int i = 0; i < NODES; i++){
+		node_t* node = NULL;
+
+		CHECK(list.insert(rng() % KEYS, i, &node));
+	}
+
+	for(int range = 0; range < RANGES; range++){
+		int key1 = (int)(rng() % (KEYS + 200)) - 100;
+		int key2 = key1 + rng() % (range % 2 ? 100 : KEYS);
+		int threads = threadNums[range % 4];
+
+		checkForEach(list, key1, key2, threads);
+		checkReduce(list, key1, key2, threads);
+	}
+
+	//the whole list, the default thread count, an empty range and key1 larger than key2
+	checkForEach(list, -1, KEYS, 0);
+	checkReduce(list, -1, KEYS, 0);
+	checkForEach(list, KEYS, KEYS + 100, 4);
+	checkReduce(list, KEYS, KEYS + 100, 4);
+	CHECK(list.parallelForEach(100, 10, [](const node_t*){ CHECK(false); }, 4) == 0);
+	CHECK(list.parallelReduce(100, 10, -1,
+		[](int, const node_t*){ CHECK(false); return 0; },
+		[](int, int){ CHECK(false); return 0; }, 4) == -1);
+
+	checkSwmrScan();
+
+	std::cout<<"parallel scan test passed"<<std::endl;
+
+	return 0;
+}
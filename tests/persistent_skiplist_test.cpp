@@ -0,0 +1,149 @@
+/*
+  persistent_skiplist_test.cpp - checks PersistentSkiplist against std::multimap across reopens,
+  after a process that crashed with the file open, and with a file that grew before its header was updated.
+*/
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include "persistent_skiplist.h"
+#include "skiplist_test.h"
+
+#define PATH "persistent_skiplist_test.db"
+#define NODES 20000		//the nodes take several times the initial size of the file
+#define KEYS 3000
+
+typedef PersistentSkiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+
+//the list has the nodes of the model in order, and a range search finds as many as the model
+static void checkFile(list_t& list, const model_t& model){
+	std::multimap<int, int> nodes;
+	skiplist_offset_t start, end, node;
+	int last = -1, count = 0;
+
+	for(node = list.first(); node; node = list.getNode(node)->next[0]){
+		CHECK(list.getNode(node)->key >= last);
+		last = list.getNode(node)->key;
+		nodes.insert(std::make_pair(last, list.getNode(node)->value));
+	}
+	CHECK(list.getNodesNum() == (int)model.size());
+	CHECK(sortedNodes(nodes) == sortedNodes(model));
+
+	if(list.search(100, 200, &start, &end)){
+		list_each_psl_node(list, start, end, node){
+			count++;
+		}
+	}
+	CHECK(count == countModel(model, 100, 200));
+
+	count = 0;
+	if(list.search(KEYS/2, &start, &end)){
+		list_each_psl_node(list, start, end, node){
+			CHECK(list.getNode(node)->key == KEYS/2);
+			count++;
+		}
+	}
+	CHECK(count == (int)model.count(KEYS/2));
+}
+
+//insert nodes with random keys, and delete every third one, the list may be NULL to only change the model
+static void fill(list_t* list, model_t& model, int seed){
+	std::mt19937 rng(seed);
+	std::vector<skiplist_offset_t> nodes(NODES, 0);
+	std::vector<int> keys(NODES);
+
+	for(int i = 0; i < NODES; i++){
+		keys[i] = rng() % KEYS;
+		model.insert(std::make_pair(keys[i], seed + i));
+		if(list){
+			CHECK(list->insert(keys[i], seed + i, &nodes[i]));
+		}
+	}
+	for(int i = 0; i < NODES; i += 3){
+		std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(keys[i]);
+
+		while(range.first->second != seed + i){
+			++range.first;
+		}
+		model.erase(range.first);
+		if(list){
+			CHECK(list->del(&nodes[i]));
+		}
+	}
+}
+
+int main(){
+	model_t model;
+	struct stat st;
+	pid_t pid;
+	int status;
+
+	unlink(PATH);
+
+	//the max level starts at 2 and grows with the nodes
+	{
+		list_t list(SkiplistDefaultComp<int>(), 1);
+
+		CHECK(list.open(PATH, 2));
+		fill(&list, model, 0);
+		CHECK(list.getCurrentLevel() > 2);
+		checkFile(list, model);
+		CHECK(list.close());
+	}
+
+	{
+		list_t list;
+
+		CHECK(list.open(PATH));
+		checkFile(list, model);
+	}
+
+	//a process that crashes after its changes, the next open rebuilds the file from level 0
+	pid = fork();
+	CHECK(pid >= 0);
+	if(0 == pid){
+		list_t list;
+		model_t ignored;
+
+		if(!list.open(PATH)){
+			_exit(1);
+		}
+		fill(&list, ignored, NODES);
+		_exit(0);
+	}
+	CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && 0 == WEXITSTATUS(status));
+	fill(NULL, model, NODES);
+
+	{
+		list_t list;
+
+		CHECK(list.open(PATH));
+		checkFile(list, model);
+	}
+
+	//a file that grew before the process crashed, so the header has the old size
+	CHECK(0 == stat(PATH, &st));
+	CHECK(0 == truncate(PATH, st.st_size * 2));
+	{
+		list_t list;
+
+		CHECK(list.open(PATH));
+		checkFile(list, model);
+		fill(&list, model, NODES*2);
+		checkFile(list, model);
+	}
+
+	{
+		list_t list;
+
+		CHECK(list.open(PATH));
+		checkFile(list, model);
+	}
+	unlink(PATH);
+
+	std::cout<<"persistent skiplist test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+  prefetch_test.cpp - builds Skiplist with SKIPLIST_ENABLE_PREFETCH and checks it against std::multimap,
+  while keys go from unique to duplicated and back, so their tails move in and out of the nodes.
+*/
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 300		//few enough that keys often gain and lose their duplicates
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+/*
+ * Every node reaches the last node of its run through its tail,
+ * and a unique key keeps its tail inside its node
+ */
+static void checkTails(list_t& list, const model_t& model){
+	for(list_t::iterator it = list.begin(); it != list.end(); ++it){
+		node_t* node = &*it;
+		node_t* last = node;
+
+		while(last->next[0] && last->next[0]->key == node->key){
+			last = last->next[0];
+		}
+		CHECK(*node->tail == last);
+		CHECK((model.count(node->key) == 1) == (node->tail == &node->inlineTail));
+	}
+}
+
+//search a key and a range, and loop over them by list_each_sl_node and the iterators
+static void checkSearch(list_t& list, const model_t& model, int key1, int key2){
+	node_t *start, *end, *node;
+	int count = 0;
+
+	if(list.search(key1, &start, &end)){
+		CHECK(start->key == key1 && end->key == key1);
+		list_each_sl_node(start, end, node){
+			CHECK(node->key == key1);
+			count++;
+		}
+	}
+	CHECK(count == (int)model.count(key1));
+
+	count = 0;
+	if(list.search(key1, key2, &start, &end)){
+		list_each_sl_node(start, end, node){
+			CHECK(node->key >= key1 && node->key <= key2);
+			count++;
+		}
+	}
+	CHECK(count == countModel(model, key1, key2));
+
+	count = 0;
+	for(list_t::iterator it = list.lower_bound(key1); it != list.upper_bound(key2); ++it){
+		CHECK(it->key >= key1 && it->key <= key2);
+		count++;
+	}
+	CHECK(count == countModel(model, key1, key2));
+}
+
+int main(){
+	std::mt19937 rng(20240611);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;		//the nodes in the list
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int key = rng() % KEYS;
+
+		if(choice < 45){
+			node_t* node = NULL;
+
+			CHECK(list.insert(key, op, &node));
+			model.insert(std::make_pair(key, op));
+			handles.push_back(node);
+		}else if(choice < 85){
+			if(handles.empty()){
+				continue;
+			}
+
+			//any node of a run, its first, last or one in the middle
+			size_t i = rng() % handles.size();
+			node_t* node = handles[i];
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(node->key);
+			model_t::iterator found = std::find_if(range.first, range.second,
+				[node](const std::pair<const int,int>& entry){ return entry.second == node->value; });
+
+			CHECK(found != range.second);
+			model.erase(found);
+			CHECK(list.del(&node));
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			checkSearch(list, model, key, key + rng() % 20);
+		}
+
+		if(op % 500 == 0){
+			checkModel(list, model);
+			checkTails(list, model);
+		}
+	}
+	checkModel(list, model);
+	checkTails(list, model);
+
+	std::cout<<"prefetch test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+  rank_test.cpp - builds Skiplist with SKIPLIST_ENABLE_RANK and checks rank, select and countRange against std::multimap
+  after insert, del, eraseRange, insertBatch, bulkLoad, split and join, which all keep the widths of the links.
+*/
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 6000
+#define KEYS 400
+#define BATCH 200
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//rank and countRange of every key, and select of every index, against the model
+static void checkRank(list_t& list, const model_t& model){
+	std::vector<std::pair<int, int> > nodes = sortedNodes(model);
+
+	checkModel(list, model);
+	for(int key = -1; key <= KEYS; key++){
+		CHECK(list.rank(key) == (int)std::distance(model.begin(), model.lower_bound(key)));
+		CHECK(list.countRange(key, key) == (int)model.count(key));
+		CHECK(list.countRange(key, key + 37) == countModel(model, key, key + 37));
+	}
+	for(int i = 0; i < (int)nodes.size(); i++){
+		node_t* node = list.select(i);
+
+		CHECK(node && node->key == nodes[i].first);
+	}
+	CHECK(NULL == list.select(-1));
+	CHECK(NULL == list.select((int)nodes.size()));
+}
+
+//insert a random node, keeping its handle
+static void insertRandom(list_t& list, model_t& model, std::vector<node_t*>& handles, std::mt19937& rng, int value){
+	node_t* node = NULL;
+	int key = rng() % KEYS;
+
+	CHECK(list.insert(key, value, &node));
+	model.insert(std::make_pair(key, value));
+	handles.push_back(node);
+}
+
+//delete the node of a handle, and its entry in the model
+static void delHandle(list_t& list, model_t& model, std::vector<node_t*>& handles, size_t i){
+	node_t* node = handles[i];
+	std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(node->key);
+	model_t::iterator found = std::find_if(range.first, range.second,
+		[node](const std::pair<const int,int>& entry){ return entry.second == node->value; });
+
+	CHECK(found != range.second);
+	model.erase(found);
+	CHECK(list.del(&node));
+	handles[i] = handles.back();
+	handles.pop_back();
+}
+
+//erase a range, the handles and the model entries go first, as eraseRange releases the nodes
+static void eraseRandom(list_t& list, model_t& model, std::vector<node_t*>& handles, int key1, int key2){
+	int erased = countModel(model, key1, key2);
+
+	for(size_t i = 0; i < handles.size();){
+		if(handles[i]->key >= key1 && handles[i]->key <= key2){
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			i++;
+		}
+	}
+	model.erase(model.lower_bound(key1), model.upper_bound(key2));
+	CHECK(list.eraseRange(key1, key2) == erased);
+}
+
+int main(){
+	std::mt19937 rng(20231107);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;
+	int value = 0;
+
+	//insert, del and eraseRange
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+
+		if(choice < 60 || handles.empty()){
+			insertRandom(list, model, handles, rng, value++);
+		}else if(choice < 95){
+			delHandle(list, model, handles, rng() % handles.size());
+		}else{
+			int key = rng() % KEYS;
+
+			eraseRandom(list, model, handles, key, key + rng() % 10);
+		}
+
+		if(op % 1000 == 0){
+			checkRank(list, model);
+		}
+	}
+	checkRank(list, model);
+
+	//a sorted batch with duplicates of the keys in the list
+	std::vector<int> keys, values;
+	std::vector<node_t*> batch(BATCH, NULL);
+
+	for(int i = 0; i < BATCH; i++){
+		keys.push_back(i*KEYS/BATCH);
+		values.push_back(value++);
+		model.insert(std::make_pair(keys[i], values[i]));
+	}
+	CHECK(list.insertBatch(keys.begin(), values.begin(), BATCH, batch.data()));
+	handles.insert(handles.end(), batch.begin(), batch.end());
+	checkRank(list, model);
+
+	//split in the middle, both parts keep their widths, and join them back
+	list_t upper;
+	model_t upperModel(model.lower_bound(KEYS/2), model.end());
+	model_t lowerModel(model.begin(), model.lower_bound(KEYS/2));
+
+	CHECK(list.split(KEYS/2, &upper));
+	checkRank(list, lowerModel);
+	checkRank(upper, upperModel);
+
+	//the nodes of both parts keep their handles
+	for(size_t i = 0; i < handles.size() && i < 100; i++){
+		if(handles[i]->key >= KEYS/2){
+			delHandle(upper, upperModel, handles, i);
+		}else{
+			delHandle(list, lowerModel, handles, i);
+		}
+	}
+	checkRank(list, lowerModel);
+	checkRank(upper, upperModel);
+
+	CHECK(list.join(&upper));
+	CHECK(upper.getNodesNum() == 0);
+	model = lowerModel;
+	model.insert(upperModel.begin(), upperModel.end());
+	checkRank(list, model);
+
+	for(int op = 0; op < OPS/4; op++){
+		if(rng() % 2 || handles.empty()){
+			insertRandom(list, model, handles, rng, value++);
+		}else{
+			delHandle(list, model, handles, rng() % handles.size());
+		}
+	}
+	checkRank(list, model);
+
+	//bulkLoad into an empty list
+	list_t loaded;
+	model_t loadedModel;
+
+	keys.clear();
+	values.clear();
+	for(int i = 0; i < KEYS*2; i++){
+		keys.push_back(i/3);
+		values.push_back(i);
+		loadedModel.insert(std::make_pair(i/3, i));
+	}
+	CHECK(loaded.bulkLoad(keys.begin(), values.begin(), KEYS*2));
+	checkRank(loaded, loadedModel);
+
+	std::cout<<"rank test passed"<<std::endl;
+
+	return 0;
+}
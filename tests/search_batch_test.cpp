@@ -0,0 +1,88 @@
+/*
+  search_batch_test.cpp - checks searchBatch against search for sorted batches, unsorted batches
+  and batches with keys that are not in the list.
+*/
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define NODES 20000
+#define KEYS 10000
+#define BATCH 500
+#define BATCHES 40
+
+typedef Skiplist<int, int> list_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//each key of a batch finds the same nodes as search, and as many as the model has
+static void checkBatch(list_t& list, const std::multimap<int, int>& model, const std::vector<int>& keys){
+	std::vector<node_t*> starts(keys.size(), NULL), ends(keys.size(), NULL);
+	int found = 0;
+
+	CHECK(list.searchBatch(keys.begin(), (int)keys.size(), starts.data(), ends.data()) >= 0);
+	for(size_t i = 0; i < keys.size(); i++){
+		node_t *start, *end, *node;
+		int count = 0;
+
+		if(list.search(keys[i], &start, &end)){
+			CHECK(starts[i] == start && ends[i] == end);
+			list_each_sl_node(start, end, node){
+				count++;
+			}
+			found++;
+		}else{
+			CHECK(NULL == starts[i] && NULL == ends[i]);
+		}
+		CHECK(count == (int)model.count(keys[i]));
+	}
+	CHECK(list.searchBatch(keys.begin(), (int)keys.size(), starts.data(), ends.data()) == found);
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	std::multimap<int, int> model;
+	list_t list;
+
+	for(int i = 0; i < NODES; i++){
+		node_t* node = NULL;
+		int key = rng() % KEYS;
+
+		CHECK(list.insert(key, i, &node));
+		model.insert(std::make_pair(key, i));
+	}
+
+	for(int batch = 0; batch < BATCHES; batch++){
+		std::vector<int> keys(BATCH);
+
+		//keys up to a half larger than the largest key of the list, so some are not found
+		for(int i = 0; i < BATCH; i++){
+			keys[i] = rng() % (KEYS + KEYS/2) - 10;
+		}
+		if(batch % 4 != 0){
+			std::sort(keys.begin(), keys.end());
+		}
+		checkBatch(list, model, keys);
+	}
+
+	//a batch of one key, and the same key again and again
+	checkBatch(list, model, std::vector<int>(1, KEYS/2));
+	checkBatch(list, model, std::vector<int>(BATCH, KEYS/3));
+
+	//an empty list
+	{
+		list_t empty;
+		std::vector<int> keys(BATCH, 1);
+		std::vector<node_t*> starts(BATCH), ends(BATCH);
+
+		CHECK(empty.searchBatch(keys.begin(), BATCH, starts.data(), ends.data()) == 0);
+		CHECK(std::count(starts.begin(), starts.end(), (node_t*)NULL) == BATCH);
+	}
+
+	std::cout<<"search batch test passed"<<std::endl;
+
+	return 0;
+}
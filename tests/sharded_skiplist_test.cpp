@@ -0,0 +1,143 @@
+/*
+  sharded_skiplist_test.cpp - checks ShardedSkiplist against std::multimap before and after rebalance,
+  then runs writers of different key ranges, range readers and rebalances at the same time.
+*/
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "sharded_skiplist.h"
+#include "skiplist_test.h"
+
+#define SHARDS 4
+#define NODES 20000
+#define KEYS 4000
+#define WRITERS 4
+#define WRITER_OPS 20000
+#define READERS 2
+
+typedef ShardedSkiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+
+//the range search visits the keys of the model in order, the value of a node is its key
+static void checkRange(list_t& list, const model_t& model, int key1, int key2){
+	std::vector<int> keys, expected;
+
+	CHECK(list.search(key1, key2, [&](list_t::node_t* node){
+		CHECK(node->value == node->key);
+		keys.push_back(node->key);
+	}) == (int)keys.size());
+
+	for(model_t::const_iterator it = model.lower_bound(key1); it != model.upper_bound(key2); ++it){
+		expected.push_back(it->first);
+	}
+	CHECK(keys == expected);
+}
+
+static void checkList(list_t& list, const model_t& model){
+	CHECK(list.getNodesNum() == (int)model.size());
+	checkRange(list, model, -1, KEYS*2);
+	for(int key = 0; key < KEYS; key += 97){
+		int count = 0;
+
+		CHECK(list.search(key, [&](list_t::node_t* node){
+			CHECK(node->key == key);
+			count++;
+		}) == (model.count(key) > 0));
+		CHECK(count == (int)model.count(key));
+		checkRange(list, model, key, key + 50);
+	}
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	list_t list(SHARDS);
+	model_t model;
+
+	//all keys go to the first shard until rebalance, the keys are skewed to the small ones
+	for(int i = 0; i < NODES; i++){
+		int key = (int)((uint64_t)(rng() % KEYS) * (rng() % KEYS) / KEYS);
+
+		CHECK(list.insert(key, key));
+		model.insert(std::make_pair(key, key));
+	}
+	checkList(list, model);
+
+	list.rebalance();
+	checkList(list, model);
+
+	for(int i = 0; i < NODES/2; i++){
+		int key = rng() % KEYS;
+
+		CHECK(list.erase(key) == (model.count(key) > 0));
+		if(model.count(key)){
+			model.erase(model.find(key));
+		}
+	}
+	list.rebalance(16);
+	checkList(list, model);
+
+	//each writer inserts and erases keys of its own range, while readers search across the shards and the splits move
+	{
+		std::vector<model_t> models(WRITERS);
+		std::vector<std::thread> threads;
+		std::atomic<int> running(WRITERS);
+
+		for(int t = 0; t < WRITERS; t++){
+			threads.emplace_back([&list, &models, &running, t]{
+				std::mt19937 rng(t);
+
+				for(int i = 0; i < WRITER_OPS; i++){
+					int key = KEYS + t*KEYS/WRITERS + rng() % (KEYS/WRITERS);
+
+					if(rng() % 3){
+						CHECK(list.insert(key, key));
+						models[t].insert(std::make_pair(key, key));
+					}else{
+						CHECK(list.erase(key) == (models[t].count(key) > 0));
+						if(models[t].count(key)){
+							models[t].erase(models[t].find(key));
+						}
+					}
+				}
+				running--;
+			});
+		}
+		for(int t = 0; t < READERS; t++){
+			threads.emplace_back([&list, &running, &model]{
+				while(running.load() > 0){
+					int last = -1;
+
+					//the nodes before KEYS don't change
+					checkRange(list, model, 0, KEYS/2);
+					list.search(0, KEYS*2, [&](list_t::node_t* node){
+						CHECK(node->key >= last);
+						last = node->key;
+					});
+				}
+			});
+		}
+		threads.emplace_back([&list, &running]{
+			while(running.load() > 0){
+				list.rebalance(64);
+				std::this_thread::yield();
+			}
+		});
+
+		for(size_t i = 0; i < threads.size(); i++){
+			threads[i].join();
+		}
+		for(int t = 0; t < WRITERS; t++){
+			model.insert(models[t].begin(), models[t].end());
+		}
+	}
+	checkList(list, model);
+	list.rebalance();
+	checkList(list, model);
+
+	std::cout<<"sharded skiplist test passed"<<std::endl;
+
+	return 0;
+}
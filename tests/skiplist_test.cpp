@@ -0,0 +1,104 @@
+/*
+  skiplist_test.cpp - checks Skiplist against std::multimap over random insert, del, and point and range searches.
+*/
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 500		//keys are drawn from 0 to KEYS-1, so most of them have duplicates
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//search a range and count the nodes by list_each_sl_node
+static void checkRange(list_t& list, const model_t& model, int key1, int key2){
+	node_t *start, *end, *node;
+	int count = 0;
+
+	if(list.search(key1, key2, &start, &end)){
+		list_each_sl_node(start, end, node){
+			CHECK(node->key >= key1 && node->key <= key2);
+			count++;
+		}
+	}
+	CHECK(count == countModel(model, key1, key2));
+}
+
+//search a key, the nodes with the key are between start and end
+static void checkKey(list_t& list, const model_t& model, int key){
+	node_t *start, *end, *node;
+	int count = 0;
+
+	if(list.search(key, &start, &end)){
+		list_each_sl_node(start, end, node){
+			CHECK(node->key == key);
+			count++;
+		}
+	}
+	CHECK(count == (int)model.count(key));
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;		//the nodes in the list
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int key = rng() % KEYS;
+
+		if(choice < 50){
+			node_t* node = NULL;
+
+			CHECK(list.insert(key, op, &node));
+			CHECK(node && node->key == key && node->value == op);
+			model.insert(std::make_pair(key, op));
+			handles.push_back(node);
+		}else if(choice < 75){
+			if(handles.empty()){
+				continue;
+			}
+
+			size_t i = rng() % handles.size();
+			node_t* node = handles[i];
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(node->key);
+			model_t::iterator found = std::find_if(range.first, range.second,
+				[node](const std::pair<const int,int>& entry){ return entry.second == node->value; });
+
+			CHECK(found != range.second);
+			model.erase(found);
+			CHECK(list.del(&node));
+			CHECK(NULL == node);
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			checkKey(list, model, key);
+			checkRange(list, model, key, key + rng() % 30);
+		}
+
+		if(op % 500 == 0){
+			checkModel(list, model);
+		}
+	}
+	checkModel(list, model);
+
+	//a node can't be deleted twice
+	node_t* removed = NULL;
+	CHECK(!list.del(&removed));
+
+	for(size_t i = 0; i < handles.size(); i++){
+		CHECK(list.del(&handles[i]));
+	}
+	CHECK(list.getNodesNum() == 0);
+	CHECK(list.begin() == list.end());
+
+	std::cout<<"skiplist test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+/*
+  skiplist_test.h - the check macro and the std::multimap model shared by the tests.
+
+  A test checks a list against a std::multimap that gets the same operations.
+  The nodes with the same key may be in another order than in the model, so both are compared sorted.
+*/
+#ifndef _SKIPLIST_TEST_H_
+#define _SKIPLIST_TEST_H_
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+#include <stdlib.h>
+
+#define CHECK(cond) do{																\
+	if(!(cond)){																	\
+		std::cout<<__FILE__<<":"<<__LINE__<<": check failed: "<<#cond<<std::endl;	\
+		exit(1);																	\
+	}																				\
+}while(0)
+
+//the keys and values of a model, sorted
+template <class Key, class Value>
+std::vector<std::pair<Key, Value> > sortedNodes(const std::multimap<Key, Value>& model){
+	std::vector<std::pair<Key, Value> > nodes(model.begin(), model.end());
+
+	std::sort(nodes.begin(), nodes.end());
+
+	return nodes;
+}
+
+//how many nodes of a model have keys within a range (key1 <= key2)
+template <class Key, class Value>
+int countModel(const std::multimap<Key, Value>& model, const Key& key1, const Key& key2){
+	return (int)std::distance(model.lower_bound(key1), model.upper_bound(key2));
+}
+
+//the list has the nodes of the model, and its iterator visits the keys in order
+template <class List, class Key, class Value>
+void checkModel(List& list, const std::multimap<Key, Value>& model){
+	std::vector<std::pair<Key, Value> > nodes;
+
+	for(typename List::iterator it = list.begin(); it != list.end(); ++it){
+		CHECK(nodes.empty() || !(it->key < nodes.back().first));
+		nodes.push_back(std::make_pair(it->key, it->value));
+	}
+	std::sort(nodes.begin(), nodes.end());
+
+	CHECK(list.getNodesNum() == (int)model.size());
+	CHECK(nodes == sortedNodes(model));
+}
+
+#endif
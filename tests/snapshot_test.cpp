@@ -0,0 +1,106 @@
+/*
+  snapshot_test.cpp - saves Skiplist to a stream and loads it into another list, for delta encoded integer keys
+  and raw keys, and checks that a truncated snapshot, a snapshot of another type and one of the other byte order
+  are refused.
+*/
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define NODES 20000
+#define KEYS 5000
+
+//fill a list and its model with keys from a generator, with duplicates
+template <class List, class Key, class Gen>
+static void fill(List& list, std::multimap<Key, int>& model, Gen key){
+	for(int i = 0; i < NODES; i++){
+		struct skiplist_node_t<Key,int>* node = NULL;
+		Key k = key(i);
+
+		CHECK(list.insert(k, i, &node));
+		model.insert(std::make_pair(k, i));
+	}
+}
+
+template <class Key, class Gen>
+static std::string checkRoundTrip(Gen key){
+	Skiplist<Key, int> list, loaded;
+	std::multimap<Key, int> model;
+	std::stringstream stream;
+
+	fill(list, model, key);
+	CHECK(list.save(stream));
+	CHECK(loaded.load(stream));
+	checkModel(loaded, model);
+
+	//a list with nodes can't load
+	stream.seekg(0);
+	CHECK(!loaded.load(stream));
+
+	return stream.str();
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	std::string snapshot;
+
+	//integer keys are written as the differences from the previous keys, negative ones too
+	snapshot = checkRoundTrip<int64_t>([&](int){ return (int64_t)(rng() % KEYS) * 1000003 - (int64_t)KEYS * 500000; });
+	checkRoundTrip<double>([&](int){ return (double)(rng() % KEYS) / 7; });
+
+	//an empty list
+	{
+		Skiplist<int, int> list, loaded;
+		std::stringstream stream;
+
+		CHECK(list.save(stream) && loaded.load(stream));
+		CHECK(loaded.getNodesNum() == 0 && loaded.begin() == loaded.end());
+	}
+
+	//a truncated snapshot keeps the nodes before the broken part
+	{
+		Skiplist<int64_t, int> loaded;
+		std::stringstream stream(snapshot.substr(0, snapshot.size() / 2));
+
+		CHECK(!loaded.load(stream));
+		CHECK(loaded.getNodesNum() > 0 && loaded.getNodesNum() < NODES);
+	}
+
+	//the key or the value has another type
+	{
+		Skiplist<int32_t, int> keys;
+		Skiplist<int64_t, int64_t> values;
+		std::stringstream keyStream(snapshot), valueStream(snapshot);
+
+		CHECK(!keys.load(keyStream) && keys.getNodesNum() == 0);
+		CHECK(!values.load(valueStream) && values.getNodesNum() == 0);
+	}
+
+	//a snapshot of the other byte order, by its flag or by its swapped header
+	{
+		struct skiplist_snapshot_header_t header;
+		std::string flagged = snapshot, swapped = snapshot;
+		Skiplist<int64_t, int> list;
+
+		memcpy(&header, flagged.data(), sizeof(header));
+		header.flags ^= SKIPLIST_SNAPSHOT_BIG_ENDIAN;
+		memcpy(&flagged[0], &header, sizeof(header));
+		std::stringstream flaggedStream(flagged);
+		CHECK(!list.load(flaggedStream) && list.getNodesNum() == 0);
+
+		memcpy(&header, swapped.data(), sizeof(header));
+		header.magic = __builtin_bswap64(header.magic);
+		header.version = __builtin_bswap32(header.version);
+		memcpy(&swapped[0], &header, sizeof(header));
+		std::stringstream swappedStream(swapped);
+		CHECK(!list.load(swappedStream) && list.getNodesNum() == 0);
+	}
+
+	std::cout<<"snapshot test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+  split_join_test.cpp - splits Skiplist into parts that different threads modify at the same time,
+  joins them back, and checks every part against std::multimap.
+*/
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define PARTS 4
+#define KEYS_PER_PART 1000
+#define NODES 8000
+#define OPS 20000
+#define ROUNDS 3
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//the nodes of a part, with the keys from part*KEYS_PER_PART up to the next part
+struct part_t{
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;
+};
+
+//insert and delete nodes of a part, a thread does it for each part at the same time
+static void modify(part_t* part, int seed){
+	std::mt19937 rng(seed);
+
+	for(int op = 0; op < OPS; op++){
+		if(part->handles.empty() || rng() % 2){
+			int key = seed * KEYS_PER_PART + rng() % KEYS_PER_PART;
+			node_t* node = NULL;
+
+			CHECK(part->list.insert(key, op, &node));
+			part->model.insert(std::make_pair(key, op));
+			part->handles.push_back(node);
+		}else{
+			size_t i = rng() % part->handles.size();
+			node_t* node = part->handles[i];
+			std::pair<model_t::iterator, model_t::iterator> range = part->model.equal_range(node->key);
+
+			while(range.first->second != node->value){
+				++range.first;
+			}
+			part->model.erase(range.first);
+			CHECK(part->list.del(&node));
+			part->handles[i] = part->handles.back();
+			part->handles.pop_back();
+		}
+	}
+}
+
+//move the nodes and the handles with keys equal or larger than a key to another part
+static void splitPart(part_t& from, part_t& to, int key){
+	CHECK(from.list.split(key, &to.list));
+	to.model.insert(from.model.lower_bound(key), from.model.end());
+	from.model.erase(from.model.lower_bound(key), from.model.end());
+
+	for(size_t i = 0; i < from.handles.size(); ){
+		if(from.handles[i]->key >= key){
+			to.handles.push_back(from.handles[i]);
+			from.handles[i] = from.handles.back();
+			from.handles.pop_back();
+		}else{
+			i++;
+		}
+	}
+	checkModel(from.list, from.model);
+	checkModel(to.list, to.model);
+}
+
+//append the nodes and the handles of another part
+static void joinPart(part_t& to, part_t& from){
+	CHECK(to.list.join(&from.list));
+	to.model.insert(from.model.begin(), from.model.end());
+	from.model.clear();
+	to.handles.insert(to.handles.end(), from.handles.begin(), from.handles.end());
+	from.handles.clear();
+	CHECK(from.list.getNodesNum() == 0);
+	checkModel(to.list, to.model);
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	part_t parts[PARTS];
+
+	for(int i = 0; i < NODES; i++){
+		int key = rng() % (PARTS * KEYS_PER_PART);
+		node_t* node = NULL;
+
+		CHECK(parts[0].list.insert(key, -i, &node));
+		parts[0].model.insert(std::make_pair(key, -i));
+		parts[0].handles.push_back(node);
+	}
+
+	for(int round = 0; round < ROUNDS; round++){
+		std::vector<std::thread> threads;
+
+		//split from the last part, so each split shares the pool of the parts split before
+		for(int i = PARTS-1; i > 0; i--){
+			splitPart(parts[0], parts[i], i * KEYS_PER_PART);
+		}
+
+		//the parts release the nodes of each other and allocate from the chunks they share
+		for(int i = 0; i < PARTS; i++){
+			threads.emplace_back(modify, &parts[i], i);
+		}
+		for(size_t i = 0; i < threads.size(); i++){
+			threads[i].join();
+		}
+
+		for(int i = 0; i < PARTS; i++){
+			checkModel(parts[i].list, parts[i].model);
+		}
+		for(int i = 1; i < PARTS; i++){
+			joinPart(parts[0], parts[i]);
+		}
+	}
+
+	//a key that is not larger can't be joined
+	{
+		node_t* node = NULL;
+
+		CHECK(parts[1].list.insert(0, 0, &node));
+		CHECK(!parts[0].list.join(&parts[1].list));
+		CHECK(parts[1].list.del(&node));
+	}
+
+	for(size_t i = 0; i < parts[0].handles.size(); i++){
+		CHECK(parts[0].list.del(&parts[0].handles[i]));
+	}
+	CHECK(parts[0].list.getNodesNum() == 0);
+
+	std::cout<<"split join test passed"<<std::endl;
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+/*
+  stats_test.cpp - built with SKIPLIST_ENABLE_STATS, checks the stats of Skiplist against the operations
+  and a std::multimap model: the calls, the level and run length histograms across split, join and eraseRange,
+  and the searches of several threads.
+*/
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_test.h"
+
+#define OPS 20000
+#define KEYS 500
+#define THREADS 4
+#define THREAD_SEARCHES 2000
+
+typedef Skiplist<int, int> list_t;
+typedef std::multimap<int, int> model_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+//the nodes, the runs and the histograms of the stats describe the list and the model
+static void checkShape(list_t& list, const model_t& model, uint64_t emptyBytes){
+	struct skiplist_stats_t stats;
+	uint64_t levels = 0, runs = 0, runLengths[SKIPLIST_STATS_RUNS] = {0};
+
+	CHECK(list.getStats(&stats));
+	CHECK(stats.nodes == model.size() && (int)stats.nodes == list.getNodesNum());
+
+	//a node with n levels is at the levels from 0 to n-1
+	for(int i = 0; i < SKIPLIST_STATS_LEVELS; i++){
+		int at = list.forEachAtLevel(i, [](node_t*){});
+		int above = list.forEachAtLevel(i + 1, [](node_t*){});
+
+		CHECK(stats.levels[i] == (uint64_t)(at - above));
+		levels += stats.levels[i];
+	}
+	CHECK(levels == stats.nodes);
+
+	for(model_t::const_iterator it = model.begin(); it != model.end(); it = model.upper_bound(it->first)){
+		uint64_t length = model.count(it->first);
+		int bucket = 63 - __builtin_clzll(length);
+
+		runLengths[(bucket < SKIPLIST_STATS_RUNS) ? bucket : SKIPLIST_STATS_RUNS-1]++;
+		runs++;
+	}
+	CHECK(stats.runs == runs);
+	for(int i = 0; i < SKIPLIST_STATS_RUNS; i++){
+		CHECK(stats.runLengths[i] == runLengths[i]);
+	}
+
+	CHECK((stats.nodes == 0) == (stats.bytes == emptyBytes));
+}
+
+//remove the model entries of the nodes with keys within a range
+static void eraseModel(model_t& model, std::vector<node_t*>& handles, int key1, int key2){
+	model.erase(model.lower_bound(key1), model.upper_bound(key2));
+	for(size_t i = 0; i < handles.size(); ){
+		if(handles[i]->key >= key1 && handles[i]->key <= key2){
+			handles[i] = handles.back();
+			handles.pop_back();
+		}else{
+			i++;
+		}
+	}
+}
+
+int main(){
+	std::mt19937 rng(20190913);
+	struct skiplist_stats_t stats;
+	uint64_t calls[SKIPLIST_STAT_OPS] = {0}, emptyBytes;
+	list_t list;
+	model_t model;
+	std::vector<node_t*> handles;
+
+	CHECK(list.getStats(&stats));
+	emptyBytes = stats.bytes;
+	CHECK(emptyBytes > 0 && stats.nodes == 0 && stats.calls[SKIPLIST_STAT_INSERT] == 0);
+
+	for(int op = 0; op < OPS; op++){
+		int choice = rng() % 100;
+		int key = rng() % KEYS;
+
+		if(choice < 50){
+			node_t* node = NULL;
+
+			CHECK(list.insert(key, op, &node));
+			model.insert(std::make_pair(key, op));
+			handles.push_back(node);
+			calls[SKIPLIST_STAT_INSERT]++;
+		}else if(choice < 75 && !handles.empty()){
+			size_t i = rng() % handles.size();
+			std::pair<model_t::iterator, model_t::iterator> range = model.equal_range(handles[i]->key);
+
+			while(range.first->second != handles[i]->value){
+				++range.first;
+			}
+			model.erase(range.first);
+			CHECK(list.del(&handles[i]));
+			handles[i] = handles.back();
+			handles.pop_back();
+			calls[SKIPLIST_STAT_DEL]++;
+		}else if(choice < 99){
+			node_t *start, *end;
+
+			list.search(key, &start, &end);
+			calls[SKIPLIST_STAT_SEARCH]++;
+		}else{
+			//the handles are dropped before their nodes are released
+			eraseModel(model, handles, key, key + 3);
+			list.eraseRange(key, key + 3);
+			calls[SKIPLIST_STAT_DEL]++;
+		}
+
+		if(op % 1000 == 0){
+			checkShape(list, model, emptyBytes);
+		}
+	}
+
+	CHECK(list.getStats(&stats));
+	CHECK(stats.calls[SKIPLIST_STAT_INSERT] == calls[SKIPLIST_STAT_INSERT]);
+	CHECK(stats.calls[SKIPLIST_STAT_DEL] == calls[SKIPLIST_STAT_DEL]);
+	CHECK(stats.calls[SKIPLIST_STAT_SEARCH] == calls[SKIPLIST_STAT_SEARCH]);
+	CHECK(stats.compares[SKIPLIST_STAT_SEARCH] >= stats.calls[SKIPLIST_STAT_SEARCH]);
+	CHECK(stats.hops[SKIPLIST_STAT_INSERT] > 0);
+
+	//the nodes and their stats move with split and back with join
+	{
+		list_t other;
+		model_t moved(model.lower_bound(KEYS/2), model.end());
+
+		CHECK(list.split(KEYS/2, &other));
+		model.erase(model.lower_bound(KEYS/2), model.end());
+		checkShape(list, model, emptyBytes);
+		checkShape(other, moved, emptyBytes);
+
+		CHECK(list.join(&other));
+		model.insert(moved.begin(), moved.end());
+		checkShape(list, model, emptyBytes);
+		checkShape(other, model_t(), emptyBytes);
+	}
+
+	//each thread counts its searches in its own counters, getStats adds them up
+	list.resetStats();
+	CHECK(list.getStats(&stats));
+	CHECK(stats.calls[SKIPLIST_STAT_SEARCH] == 0 && stats.nodes == model.size());
+	{
+		std::vector<std::thread> threads;
+
+		for(int t = 0; t < THREADS; t++){
+			threads.emplace_back([&list, t]{
+				node_t *start, *end;
+
+				for(int i = 0; i < THREAD_SEARCHES; i++){
+					list.search((i + t) % KEYS, &start, &end);
+				}
+			});
+		}
+		for(size_t i = 0; i < threads.size(); i++){
+			threads[i].join();
+		}
+	}
+	CHECK(list.getStats(&stats));
+	CHECK(stats.calls[SKIPLIST_STAT_SEARCH] == THREADS*THREAD_SEARCHES);
+
+	//the nodes of a released list don't count in a new list
+	for(size_t i = 0; i < handles.size(); i++){
+		CHECK(list.del(&handles[i]));
+	}
+	checkShape(list, model_t(), emptyBytes);
+	{
+		list_t fresh;
+
+		CHECK(fresh.getStats(&stats));
+		CHECK(stats.calls[SKIPLIST_STAT_SEARCH] == 0 && stats.nodes == 0);
+	}
+
+	std::cout<<"stats test passed"<<std::endl;
+
+	return 0;
+}
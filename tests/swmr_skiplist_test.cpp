@@ -0,0 +1,94 @@
+/*
+  swmr_skiplist_test.cpp - runs a Skiplist with the SkiplistSwmrSync policy, one writer and several readers,
+  then checks the nodes left against the handles of the writer.
+*/
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "skiplist.h"
+#include "skiplist_epoch.h"
+#include "skiplist_test.h"
+
+#define READERS 3
+#define KEYS 4000
+#define OPS 40000
+#define SCAN 32
+
+typedef Skiplist<int, int, SkiplistDefaultComp<int>, SkiplistSlabAllocator, SkiplistSwmrSync> list_t;
+typedef struct skiplist_node_t<int,int> node_t;
+
+/*
+ * The even keys stay in the list, and the writer inserts and deletes the odd keys.
+ * The readers check that the even keys are found, and that a scan from lower_bound sees the keys in order
+ */
+int main(){
+	list_t list;
+	std::vector<node_t*> odd(KEYS, NULL);
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> readers;
+	int count = KEYS;
+
+	for(int i = 0; i < KEYS; i++){
+		node_t* node = NULL;
+
+		CHECK(list.insert(2*i, 2*i, &node));
+	}
+
+	for(int t = 0; t < READERS; t++){
+		readers.emplace_back([&list, &stop, t]{
+			std::mt19937 rng(t);
+
+			while(!stop.load()){
+				SkiplistEpochGuard guard;
+				node_t *start, *end;
+				int key = 2*(rng() % KEYS);
+				int prev = key - 1;
+				int scanned = 0;
+
+				CHECK(list.search(key, &start, &end));
+				CHECK(start->key == key && start->value == key);
+
+				//the writer may remove the node after a range, so the scan stops by its count, or at the last even key
+				for(list_t::iterator it = list.lower_bound(key); it != list.end() && scanned < SCAN; ++it, scanned++){
+					CHECK(it->key > prev && it->value == it->key);
+					prev = it->key;
+				}
+				CHECK(scanned == SCAN || prev >= 2*KEYS - 2);
+
+				CHECK(list.getNodesNum() >= KEYS && list.getNodesNum() <= 2*KEYS);
+				CHECK(list.getCurrentLevel() >= 1);
+			}
+		});
+	}
+
+	std::mt19937 rng(OPS);
+	for(int op = 0; op < OPS; op++){
+		int i = rng() % KEYS;
+
+		if(NULL == odd[i]){
+			CHECK(list.insert(2*i + 1, 2*i + 1, &odd[i]));
+			count++;
+		}else{
+			CHECK(list.del(&odd[i]));
+			CHECK(NULL == odd[i]);
+			count--;
+		}
+	}
+
+	stop.store(true);
+	for(size_t i = 0; i < readers.size(); i++){
+		readers[i].join();
+	}
+
+	CHECK(list.getNodesNum() == count);
+	for(int key = 0; key < 2*KEYS; key++){
+		node_t *start, *end;
+
+		CHECK(list.search(key, &start, &end) == (key % 2 == 0 || odd[key/2] != NULL));
+	}
+
+	std::cout<<"swmr skiplist test passed"<<std::endl;
+
+	return 0;
+}